@@ -10,6 +10,9 @@
 
 // 内部関数
 //
+static short ActorGetBlockIndex(struct Actor *actor);
+static struct Actor *ActorGetBlock(short index);
+static unsigned char ActorGetFunctionId(ActorFunction function);
 
 // 内部変数
 //
@@ -27,7 +30,7 @@ void ActorInitialize(void)
     }
 
     // アクタコントローラの作成
-    actorController = playdate->system->realloc(NULL, sizeof (struct ActorController));
+    actorController = IocsRealloc(kIocsMemoryTagActor, NULL, sizeof (struct ActorController));
     if (actorController == NULL) {
         playdate->system->error("%s: %d: actor controller instance is not created.", __FILE__, __LINE__);
         return;
@@ -43,6 +46,10 @@ void ActorInitialize(void)
             next->priorityPrevious = here;
         }
         actorController->free = (struct Actor *)actorController->blocks[0];
+
+        // ID 0 は NULL
+        actorController->functions[0] = NULL;
+        actorController->functionSize = 1;
     }
 }
 
@@ -84,9 +91,12 @@ void ActorDraw(void)
         return;
     }
 
-    // アクタの描画
+    // アクタの描画コマンドの記録
     for (int i = 0; i < kActorOrderSize; i++) {
         struct Actor *actor = actorController->orders[i];
+        if (actor != NULL) {
+            IocsSetDrawOrder(i);
+        }
         while (actor != NULL) {
             struct Actor *next = actor->orderNext;
             if (actor->draw != NULL) {
@@ -95,6 +105,9 @@ void ActorDraw(void)
             actor = next;
         }
     }
+
+    // 描画コマンドの発行
+    IocsSubmitDraw();
 }
 
 // アクタを読み込む
@@ -318,3 +331,154 @@ struct Actor *ActorNextWithTag(struct Actor *actor)
 {
     return actor->tagNext;
 }
+
+// アクタの状態をバッファに保存する
+//
+int ActorSave(void *buffer, int size)
+{
+    // Playdate の取得
+    PlaydateAPI *playdate = IocsGetPlaydate();
+    if (playdate == NULL) {
+        return 0;
+    }
+
+    // バッファの確認
+    int payload = kActorBlockSize - sizeof (struct Actor);
+    if (size < (int)sizeof (struct ActorSnapshot)) {
+        return 0;
+    }
+
+    // リンクの保存
+    struct ActorSnapshot *snapshot = (struct ActorSnapshot *)buffer;
+    snapshot->free = ActorGetBlockIndex(actorController->free);
+    for (int i = 0; i < kActorPrioritySize; i++) {
+        snapshot->prioritys[i] = ActorGetBlockIndex(actorController->prioritys[i]);
+    }
+    for (int i = 0; i < kActorTagSize; i++) {
+        snapshot->tags[i] = ActorGetBlockIndex(actorController->tags[i]);
+    }
+    for (int i = 0; i < kActorEntry; i++) {
+        struct Actor *actor = (struct Actor *)actorController->blocks[i];
+        snapshot->links[i].priorityPrevious = ActorGetBlockIndex(actor->priorityPrevious);
+        snapshot->links[i].priorityNext = ActorGetBlockIndex(actor->priorityNext);
+        snapshot->links[i].tagPrevious = ActorGetBlockIndex(actor->tagPrevious);
+        snapshot->links[i].tagNext = ActorGetBlockIndex(actor->tagNext);
+    }
+
+    // 使用中のアクタブロックの保存（描画順は毎フレーム作り直されるので含めない）
+    unsigned char *p = (unsigned char *)buffer + sizeof (struct ActorSnapshot);
+    snapshot->blockSize = 0;
+    for (int i = 0; i < kActorPrioritySize; i++) {
+        for (struct Actor *actor = actorController->prioritys[i]; actor != NULL; actor = actor->priorityNext) {
+            if (p + sizeof (struct ActorSnapshotBlock) + payload > (unsigned char *)buffer + size) {
+                return 0;
+            }
+            struct ActorSnapshotBlock block;
+            block.index = ActorGetBlockIndex(actor);
+            block.priority = (unsigned char)actor->priority;
+            block.tag = (unsigned char)actor->tag;
+            block.order = (short)actor->order;
+            block.update = ActorGetFunctionId(actor->update);
+            block.unload = ActorGetFunctionId(actor->unload);
+            block.draw = ActorGetFunctionId(actor->draw);
+            block.state = actor->state;
+            memcpy(p, &block, sizeof (struct ActorSnapshotBlock));
+            memcpy(p + sizeof (struct ActorSnapshotBlock), actor + 1, payload);
+            p += sizeof (struct ActorSnapshotBlock) + payload;
+            ++snapshot->blockSize;
+        }
+    }
+
+    // 終了
+    return (int)(p - (unsigned char *)buffer);
+}
+
+// アクタの状態をバッファから復元する
+//
+int ActorRestore(const void *buffer, int size)
+{
+    // Playdate の取得
+    PlaydateAPI *playdate = IocsGetPlaydate();
+    if (playdate == NULL) {
+        return 0;
+    }
+
+    // バッファの確認
+    int payload = kActorBlockSize - sizeof (struct Actor);
+    const struct ActorSnapshot *snapshot = (const struct ActorSnapshot *)buffer;
+    if (size < (int)sizeof (struct ActorSnapshot) || size < (int)(sizeof (struct ActorSnapshot) + snapshot->blockSize * (sizeof (struct ActorSnapshotBlock) + payload))) {
+        return 0;
+    }
+
+    // リンクの復元（保存時にいなかったアクタの解放処理は呼ばれない）
+    actorController->free = ActorGetBlock(snapshot->free);
+    for (int i = 0; i < kActorPrioritySize; i++) {
+        actorController->prioritys[i] = ActorGetBlock(snapshot->prioritys[i]);
+    }
+    for (int i = 0; i < kActorOrderSize; i++) {
+        actorController->orders[i] = NULL;
+    }
+    for (int i = 0; i < kActorTagSize; i++) {
+        actorController->tags[i] = ActorGetBlock(snapshot->tags[i]);
+    }
+    for (int i = 0; i < kActorEntry; i++) {
+        struct Actor *actor = (struct Actor *)actorController->blocks[i];
+        actor->priorityPrevious = ActorGetBlock(snapshot->links[i].priorityPrevious);
+        actor->priorityNext = ActorGetBlock(snapshot->links[i].priorityNext);
+        actor->orderPrevious = NULL;
+        actor->orderNext = NULL;
+        actor->tagPrevious = ActorGetBlock(snapshot->links[i].tagPrevious);
+        actor->tagNext = ActorGetBlock(snapshot->links[i].tagNext);
+    }
+
+    // 使用中のアクタブロックの復元
+    const unsigned char *p = (const unsigned char *)buffer + sizeof (struct ActorSnapshot);
+    for (int i = 0; i < snapshot->blockSize; i++) {
+        struct ActorSnapshotBlock block;
+        memcpy(&block, p, sizeof (struct ActorSnapshotBlock));
+        struct Actor *actor = ActorGetBlock(block.index);
+        actor->priority = block.priority;
+        actor->tag = block.tag;
+        actor->order = block.order;
+        actor->update = actorController->functions[block.update];
+        actor->unload = actorController->functions[block.unload];
+        actor->draw = actorController->functions[block.draw];
+        actor->state = block.state;
+        memcpy(actor + 1, p + sizeof (struct ActorSnapshotBlock), payload);
+        p += sizeof (struct ActorSnapshotBlock) + payload;
+    }
+
+    // 終了
+    return (int)(p - (const unsigned char *)buffer);
+}
+
+// アクタブロックのインデックスを取得する
+//
+static short ActorGetBlockIndex(struct Actor *actor)
+{
+    return actor != NULL ? (short)(((uint8_t *)actor - actorController->blocks[0]) / kActorBlockSize) : kActorSnapshotNull;
+}
+static struct Actor *ActorGetBlock(short index)
+{
+    return index != kActorSnapshotNull ? (struct Actor *)actorController->blocks[index] : NULL;
+}
+
+// 処理関数の ID を取得する
+//
+static unsigned char ActorGetFunctionId(ActorFunction function)
+{
+    // 登録済みの ID の検索
+    for (int i = 0; i < actorController->functionSize; i++) {
+        if (actorController->functions[i] == function) {
+            return (unsigned char)i;
+        }
+    }
+
+    // ID の登録
+    if (actorController->functionSize >= kActorFunctionSize) {
+        IocsGetPlaydate()->system->error("%s: %d: actor function id is over.", __FILE__, __LINE__);
+        return 0;
+    }
+    actorController->functions[actorController->functionSize] = function;
+    return (unsigned char)actorController->functionSize++;
+}
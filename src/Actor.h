@@ -78,6 +78,59 @@ enum {
     kActorBlockSize = 1024, 
 };
 
+// スナップショット
+//
+enum {
+    kActorSnapshotNull = -1, 
+    kActorFunctionSize = 64, 
+};
+struct ActorSnapshotLink {
+
+    // プライオリティ
+    short priorityPrevious;
+    short priorityNext;
+
+    // タグ
+    short tagPrevious;
+    short tagNext;
+
+};
+struct ActorSnapshotBlock {
+
+    // アクタブロックのインデックス
+    short index;
+
+    // プライオリティ、描画順、タグ
+    unsigned char priority;
+    unsigned char tag;
+    short order;
+
+    // 処理関数の ID
+    unsigned char update;
+    unsigned char unload;
+    unsigned char draw;
+
+    // 状態
+    int state;
+
+};
+struct ActorSnapshot {
+
+    // 解放されたアクタのリンク
+    short free;
+
+    // プライオリティ別、タグ別のアクタのリンク
+    short prioritys[kActorPrioritySize];
+    short tags[kActorTagSize];
+
+    // すべてのアクタブロックのリンク
+    struct ActorSnapshotLink links[kActorEntry];
+
+    // 続くアクタブロックの数
+    int blockSize;
+
+};
+
 // アクタコントローラ
 //
 struct ActorController {
@@ -96,6 +149,10 @@ struct ActorController {
 
     // アクタブロック
     uint8_t blocks[kActorEntry][kActorBlockSize];
+
+    // スナップショットで使う処理関数の ID
+    ActorFunction functions[kActorFunctionSize];
+    int functionSize;
     
 };
 
@@ -117,3 +174,5 @@ extern void ActorSetTag(struct Actor *actor, int tag);
 extern void ActorUnsetTag(struct Actor *actor);
 extern struct Actor *ActorFindWithTag(int tag);
 extern struct Actor *ActorNextWithTag(struct Actor *actor);
+extern int ActorSave(void *buffer, int size);
+extern int ActorRestore(const void *buffer, int size);
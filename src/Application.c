@@ -21,7 +21,15 @@ static SceneFunction functions[kApplicationSceneSize] = {
     (SceneFunction)TitleUpdate, 
     (SceneFunction)GameUpdate, 
 };
+static SceneManifestFunction manifests[kApplicationSceneSize] = {
+    NULL, 
+    NULL, 
+    GameGetManifest, 
+};
 static struct Application *application = NULL;
+#if defined(APPLICATION_RECORD) || defined(APPLICATION_REPLAY)
+static const char *applicationRecordPath = "record.bin";
+#endif
 
 
 // アプリケーションを初期化する
@@ -35,7 +43,7 @@ void ApplicationInitialize(void)
     }
 
     // アプリケーションの作成
-    application = playdate->system->realloc(NULL, sizeof (struct Application));
+    application = IocsRealloc(kIocsMemoryTagApplication, NULL, sizeof (struct Application));
     if (application == NULL) {
         playdate->system->error("%s: %d: application instance is not created.", __FILE__, __LINE__);
         return;
@@ -48,6 +56,13 @@ void ApplicationInitialize(void)
         application->score = kApplicationScoreDefault;
     }
 
+    // 入力の記録／再生の開始（乱数はシーンごとに固定の種から作るので、起動から始めれば入力だけで再現できる）
+#if defined(APPLICATION_RECORD)
+    IocsStartRecord(applicationRecordPath);
+#elif defined(APPLICATION_REPLAY)
+    IocsStartReplay(applicationRecordPath);
+#endif
+
     // シーンの遷移
     ApplicationTransition(kApplicationSceneGame);
 }
@@ -59,6 +74,15 @@ void ApplicationTransition(ApplicationScene scene)
     SceneTransition(functions[scene]);
 }
 
+// アプリケーションのシーンを先読みする
+//
+void ApplicationPrefetch(ApplicationScene scene)
+{
+    if (manifests[scene] != NULL) {
+        ScenePrefetch(functions[scene], (*manifests[scene])());
+    }
+}
+
 // スコアを取得する
 //
 int ApplicationGetScore(void)
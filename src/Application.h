@@ -35,5 +35,6 @@ struct Application {
 //
 extern void ApplicationInitialize(void);
 extern void ApplicationTransition(ApplicationScene scene);
+extern void ApplicationPrefetch(ApplicationScene scene);
 extern int ApplicationGetScore(void);
 extern bool ApplicationSetScore(int score);
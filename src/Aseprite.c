@@ -7,6 +7,7 @@
 #include <string.h>
 #include "pd_api.h"
 #include "Iocs.h"
+#include "Scene.h"
 #include "Aseprite.h"
 
 
@@ -48,7 +49,7 @@ void AsepriteInitialize(const char *spritePath)
     }
 
     // Aseprite コントローラの作成
-    asepriteController = playdate->system->realloc(NULL, sizeof (struct AsepriteController));
+    asepriteController = IocsRealloc(kIocsMemoryTagAseprite, NULL, sizeof (struct AsepriteController));
     if (asepriteController == NULL) {
         playdate->system->error("%s: %d: aseprite controller instance is not created.", __FILE__, __LINE__);
         return;
@@ -69,6 +70,11 @@ void AsepriteLoadSprite(const char *spriteName)
         return;
     }
 
+    // 読み込み済みのスプライト（先読みされたものなど）はそのまま使う
+    if (spriteName[0] != '\0' && AsepriteFindSprite(spriteName) != NULL) {
+        return;
+    }
+
     // スプライトの登録
     struct AsepriteSprite *sprite = NULL;
     for (int i = 0; i < kAsepriteSpriteEntry; i++) {
@@ -126,12 +132,12 @@ void AsepriteLoadSprite(const char *spriteName)
 
         // フレームの作成
         if (sprite->frameSize > 0) {
-            sprite->frames = playdate->system->realloc(NULL, sprite->frameSize * sizeof (struct AsepriteSpriteFrame));
+            sprite->frames = SceneAllocate(sprite->frameSize * sizeof (struct AsepriteSpriteFrame));
         }
 
         // タグの作成
         if (sprite->tagSize > 0) {
-            sprite->tags = playdate->system->realloc(NULL, sprite->tagSize * sizeof (struct AsepriteSpriteTag));
+            sprite->tags = SceneAllocate(sprite->tagSize * sizeof (struct AsepriteSpriteTag));
         }
 
         // .json のデコード: 2 pass
@@ -153,7 +159,7 @@ void AsepriteLoadSprite(const char *spriteName)
         strcat(path, ".png");
 
         // ビットマップ配列の作成
-        sprite->bitmaps = playdate->system->realloc(NULL, sprite->frameSize * sizeof (struct LCDBitmap *));
+        sprite->bitmaps = SceneAllocate(sprite->frameSize * sizeof (struct LCDBitmap *));
         if (sprite->bitmaps == NULL) {
             playdate->system->error("%s: %d: bitmap array is not allocated.", __FILE__, __LINE__);
             return;
@@ -215,16 +221,6 @@ static void AsepriteFreeSprite(struct AsepriteSprite *sprite)
         // .json の解放
         AsepriteUnloadJson(&sprite->json);
 
-        // frames の解放
-        if (sprite->frames != NULL) {
-            playdate->system->realloc(sprite->frames, 0);
-        }
-
-        // frameTags の解放
-        if (sprite->tags != NULL) {
-            playdate->system->realloc(sprite->tags, 0);
-        }
-
         // ビットマップの解放
         if (sprite->bitmaps != NULL) {
             for (int i = 0; i < sprite->frameSize; i++) {
@@ -232,13 +228,21 @@ static void AsepriteFreeSprite(struct AsepriteSprite *sprite)
                     playdate->graphics->freeBitmap(sprite->bitmaps[i]);
                 }
             }
-            playdate->system->realloc(sprite->bitmaps, 0);
         }
 
+        // frames と frameTags とビットマップ配列はシーンのアリーナと一緒に解放される
+        sprite->frames = NULL;
+        sprite->tags = NULL;
+        sprite->bitmaps = NULL;
+
         // スプライトの登録の解除
         sprite->name[0] = '\0';
     }
 }
+bool AsepriteIsSpriteLoaded(const char *spriteName)
+{
+    return spriteName[0] != '\0' && AsepriteFindSprite(spriteName) != NULL ? true : false;
+}
 void AsepriteUnloadSprite(const char *spriteName)
 {
     AsepriteFreeSprite(AsepriteFindSprite(spriteName));
@@ -314,12 +318,12 @@ void AsepriteLoadSpriteJson(struct AsepriteSprite *sprite, const char *path)
 
         // フレームの作成
         if (sprite->frameSize > 0) {
-            sprite->frames = playdate->system->realloc(NULL, sprite->frameSize * sizeof (struct AsepriteSpriteFrame));
+            sprite->frames = SceneAllocate(sprite->frameSize * sizeof (struct AsepriteSpriteFrame));
         }
 
         // タグの作成
         if (sprite->tagSize > 0) {
-            sprite->tags = playdate->system->realloc(NULL, sprite->tagSize * sizeof (struct AsepriteSpriteTag));
+            sprite->tags = SceneAllocate(sprite->tagSize * sizeof (struct AsepriteSpriteTag));
         }
 
         // .json のデコード: 2 pass
@@ -649,8 +653,7 @@ void AsepriteDrawSpriteAnimation(struct AsepriteSpriteAnimation *animation, int
     // ビットマップの描画
     {
         struct AsepriteSpriteFrame *frame = &animation->sprite->frames[animation->play];
-        playdate->graphics->setDrawMode(mode);
-        playdate->graphics->drawBitmap(animation->sprite->bitmaps[animation->play], x, y, flip);
+        IocsDrawBitmap(animation->sprite->bitmaps[animation->play], x, y, frame->frame.w, frame->frame.h, mode, flip);
     }
 }
 void AsepriteDrawRotatedSpriteAnimation(struct AsepriteSpriteAnimation *animation, int x, int y, float degrees, float centerx, float centery, float xscale, float yscale, LCDBitmapDrawMode mode)
@@ -664,11 +667,21 @@ void AsepriteDrawRotatedSpriteAnimation(struct AsepriteSpriteAnimation *animatio
     // ビットマップの描画
     {
         struct AsepriteSpriteFrame *frame = &animation->sprite->frames[animation->play];
-        playdate->graphics->setDrawMode(mode);
-        playdate->graphics->drawRotatedBitmap(animation->sprite->bitmaps[animation->play], x, y, degrees, centerx, centery, xscale, yscale);
+        IocsDrawRotatedBitmap(animation->sprite->bitmaps[animation->play], x, y, frame->frame.w, frame->frame.h, degrees, centerx, centery, xscale, yscale, mode);
     }
 }
 
+// スプライトアニメーションが画面に入るかどうかを判定する
+//
+bool AsepriteIsSpriteAnimationVisible(struct AsepriteSpriteAnimation *animation, int x, int y, float centerx, float centery)
+{
+    // 現在のフレームの切り抜かれた大きさで判定する
+    struct AsepriteSpriteFrame *frame = &animation->sprite->frames[animation->play];
+    int left = x - (int)(centerx * frame->spriteSourceSize.w) - 1;
+    int top = y - (int)(centery * frame->spriteSourceSize.h) - 1;
+    return IocsIsDrawVisible(left, top, left + frame->spriteSourceSize.w + 2, top + frame->spriteSourceSize.h + 2);
+}
+
 // スプライトアニメーションの現在のフレームインデックスを取得する
 //
 int AsepriteGetSpriteAnimationPlayFrameIndex(struct AsepriteSpriteAnimation *animation)
@@ -720,7 +733,7 @@ static bool AsepriteLoadJson(struct AsepriteJson *json, const char *path)
     // ファイルの読み込み
     FileStat stat;
     if (playdate->file->stat(path, &stat) == 0) {
-        json->base = playdate->system->realloc(NULL, stat.size);
+        json->base = IocsRealloc(kIocsMemoryTagAseprite, NULL, stat.size);
         if (json->base != NULL) {
             SDFile *file = playdate->file->open(path, kFileRead);
             if (file != NULL) {
@@ -748,7 +761,7 @@ static void AsepriteUnloadJson(struct AsepriteJson *json)
 
     // .json の解放
     if (json->base != NULL) {
-        playdate->system->realloc(json->base, 0);
+        IocsRealloc(kIocsMemoryTagAseprite, json->base, 0);
         json->base = NULL;
     }
 }
@@ -116,6 +116,7 @@ struct AsepriteController {
 extern void AsepriteInitialize(const char *spritePath);
 extern void AsepriteLoadSprite(const char *spriteName);
 extern void AsepriteLoadSpriteList(const char *spriteNames[], int entry);
+extern bool AsepriteIsSpriteLoaded(const char *spriteName);
 extern void AsepriteUnloadSprite(const char *spriteName);
 extern void AsepriteUnloadAllSprites(void);
 extern void AsepriteLoadSpriteJson(struct AsepriteSprite *sprite, const char *path);
@@ -126,5 +127,6 @@ extern void AsepriteUpdateSpriteAnimation(struct AsepriteSpriteAnimation *animat
 extern bool AsepriteIsSpriteAnimationDone(struct AsepriteSpriteAnimation *animation);
 extern void AsepriteDrawSpriteAnimation(struct AsepriteSpriteAnimation *animation, int x, int y, LCDBitmapDrawMode mode, LCDBitmapFlip flip);
 extern void AsepriteDrawRotatedSpriteAnimation(struct AsepriteSpriteAnimation *animation, int x, int y, float degrees, float centerx, float centery, float xscale, float yscale, LCDBitmapDrawMode mode);
+extern bool AsepriteIsSpriteAnimationVisible(struct AsepriteSpriteAnimation *animation, int x, int y, float centerx, float centery);
 extern int AsepriteGetSpriteAnimationPlayFrameIndex(struct AsepriteSpriteAnimation *animation);
 
@@ -8,20 +8,51 @@
 #include <string.h>
 #include "pd_api.h"
 #include "Iocs.h"
+#include "IocsRandom.h"
 
 
 // 内部関数
 //
+static void IocsInitializeFrame(void);
+static void IocsInitializeMemory(void);
+static void IocsCountMemory(IocsMemoryTag tag, int byte, int count);
+static void IocsPrintMemory(int x, int y);
 static void IocsInitializeFont(void);
+static int IocsFindTextCache(IocsFont font, const char *text);
+static void IocsTrimTextCache(int byte);
 static void IocsInitializeScreen(void);
+static void IocsResetDraw(void);
+static struct IocsDrawCommand *IocsAddDrawCommand(IocsDrawType type, int left, int top, int right, int bottom, LCDBitmapDrawMode mode);
+static void IocsPrintDraw(int x, int y);
 static void IocsInitializeButton(void);
 static void IocsUpdateButton(void);
+static void IocsUpdateButtonRepeat(void);
+static int IocsButtonCallback(PDButtons button, int down, uint32_t when, void *userdata);
+static void IocsAddButtonEvent(PDButtons button, bool down, uint32_t when);
+static void IocsSynthesizeButtonEvents(PDButtons previous, PDButtons push, PDButtons edge);
 static void IocsPrintButton(int x, int y, PDButtons button);
 static void IocsInitializeCrank(void);
 static void IocsUpdateCrank(void);
 static void IocsPrintCrank(int x, int y, float crank);
 static void IocsInitializeAudio(void);
+static void IocsFinishAudioEffect(SoundSource *source, void *userdata);
+static void IocsCollectAudioEffects(void);
+static int IocsStealAudioEffect(int sample);
+static void IocsUpdateAudio(void);
+static int IocsFindAudioBank(const char *name);
+static int IocsRetainAudioEffect(const char *path);
+static void IocsLoadAudioEffect(int sample);
+static void IocsUnloadAudioEffect(int sample);
 static void IocsInitializeRandom(void);
+static void IocsInitializeRecord(void);
+static void IocsUpdateRecord(void);
+static void IocsWriteRecord(void);
+static void IocsReadRecord(void);
+static void IocsPutRecord(uint32_t value, int size);
+static uint32_t IocsGetRecord(int size);
+static void IocsFlushRecord(void);
+static int IocsQuantizeCrank(float angle);
+static void IocsSetRecordCrank(int crank);
 
 // 内部変数
 //
@@ -31,6 +62,23 @@ static const char *fontPaths[] = {
     "fonts/misaki_gothic", 
     "fonts/font-game", 
 };
+#ifdef IOCS_MEMORY_TRACE
+static const char *memoryTagNames[] = {
+    "system", 
+    "application", 
+    "scene", 
+    "actor", 
+    "aseprite", 
+    "field", 
+    "maze", 
+    "path", 
+    "nav", 
+    "player", 
+    "enemy", 
+    "hit", 
+    "snapshot", 
+};
+#endif
 static const char *audioPaths[] = {
     "sounds/null", 
     "sounds/pipo", 
@@ -56,6 +104,12 @@ void IocsInitialize(PlaydateAPI *playdate)
     // フレームレートの設定
     playdate->display->setRefreshRate(kIocsFrameRate);
 
+    // メモリの初期化
+    IocsInitializeMemory();
+
+    // フレームの初期化
+    IocsInitializeFrame();
+
     // フォントの初期化
     IocsInitializeFont();
 
@@ -74,6 +128,9 @@ void IocsInitialize(PlaydateAPI *playdate)
     // 乱数の初期化
     IocsInitializeRandom();
 
+    // 記録の初期化
+    IocsInitializeRecord();
+
     // 乱数の初期化
     srand(playdate->system->getSecondsSinceEpoch(NULL));
 
@@ -122,10 +179,12 @@ void IocsEventHandler(PDSystemEvent event, uint32_t arg)
     // kEventResume: 一時停止からの復帰
     } else if (event == kEventResume) {
 		playdate->system->logToConsole("%s: %d: kEventResume.", __FILE__, __LINE__);
+        IocsInitializeFrame();
 
     // kEventTerminate: 停止
     } else if (event == kEventTerminate) {
 		playdate->system->logToConsole("%s: %d: kEventTerminate.", __FILE__, __LINE__);
+        IocsStopRecord();
 
     // kEventKeyPressed: キーが押される
     } else if (event == kEventKeyPressed) {
@@ -152,11 +211,27 @@ void IocsUpdateBegin(void)
         return;
     }
 
+    // このフレームで確保した回数のリセット
+    memset(iocs->memory.frameCounts, 0, sizeof (iocs->memory.frameCounts));
+    iocs->memory.frameCount = 0;
+
     // ボタンの更新
     IocsUpdateButton();
 
     // クランクの更新
     IocsUpdateCrank();
+
+    // 記録の更新
+    IocsUpdateRecord();
+
+    // オーディオの更新
+    IocsUpdateAudio();
+
+    // リピートの更新
+    IocsUpdateButtonRepeat();
+
+    // このフレームで開始したステップの数
+    ++iocs->frameStepBegin;
 }
 
 // 入出力制御システムの更新を終了する
@@ -169,6 +244,22 @@ void IocsUpdateEnd(void)
         return;
     }
 
+    // 記録／再生したフレームの数
+    if (iocs->recordMode != kIocsRecordNull) {
+        ++iocs->recordFrame;
+    }
+}
+
+// 入出力制御システムを描画する
+//
+void IocsDraw(void)
+{
+    // Playdate の取得
+    PlaydateAPI *playdate = IocsGetPlaydate();
+    if (playdate == NULL) {
+        return;
+    }
+
     // デバッグ
     /*
     IocsPrintButton(  1, 1, iocs->buttonPush);
@@ -179,6 +270,71 @@ void IocsUpdateEnd(void)
     IocsPrintCrank( 1, 1, iocs->crankAngle);
     IocsPrintCrank(81, 1, iocs->crankChange);
     */
+    /*
+    IocsPrintMemory(1, 1);
+    */
+    /*
+    IocsPrintDraw(1, 1);
+    */
+
+    // フレームレートの表示
+    playdate->system->drawFPS(0, 0);
+}
+
+// フレームを初期化する
+//
+static void IocsInitializeFrame(void)
+{
+    // Playdate の取得
+    PlaydateAPI *playdate = IocsGetPlaydate();
+    if (playdate == NULL) {
+        return;
+    }
+
+    // 経過時間のリセット
+    playdate->system->resetElapsedTime();
+    iocs->frameAccumulator = kIocsFrameMicrosecond;
+    iocs->frameStep = 0;
+    iocs->frameStepBegin = 0;
+    iocs->frameAlpha = 0.0f;
+}
+
+// 経過時間からこのフレームで進める固定ステップの数を求める
+//
+int IocsUpdateFrame(void)
+{
+    // Playdate の取得
+    PlaydateAPI *playdate = IocsGetPlaydate();
+    if (playdate == NULL) {
+        return 0;
+    }
+
+    // 経過時間の取得
+    int elapsed = (int)(playdate->system->getElapsedTime() * 1000000.0f);
+    playdate->system->resetElapsedTime();
+
+    // フレームの整数倍に近い経過時間はリフレッシュのゆらぎとみなしてそろえる
+    int frame = (elapsed + kIocsFrameMicrosecond / 2) / kIocsFrameMicrosecond;
+    if (frame > 0 && abs(elapsed - frame * kIocsFrameMicrosecond) < kIocsFrameSnapMicrosecond) {
+        elapsed = frame * kIocsFrameMicrosecond;
+    }
+    iocs->frameAccumulator += elapsed;
+
+    // ステップの数（上限を超えた分は捨ててゲームの速度を落とす）
+    int step = iocs->frameAccumulator / kIocsFrameMicrosecond;
+    if (step > kIocsFrameStepMaximum) {
+        step = kIocsFrameStepMaximum;
+        iocs->frameAccumulator = step * kIocsFrameMicrosecond;
+    }
+    iocs->frameAccumulator -= step * kIocsFrameMicrosecond;
+    iocs->frameStep = step;
+    iocs->frameStepBegin = 0;
+
+    // 描画の補間値
+    iocs->frameAlpha = (float)iocs->frameAccumulator / kIocsFrameMicrosecond;
+
+    // 終了
+    return step;
 }
 
 // フレームレートを取得する
@@ -192,6 +348,191 @@ int IocsGetFrameMillisecond(void)
     return kIocsFrameMillisecond;
 }
 
+// このフレームで進めた固定ステップの数を取得する
+//
+int IocsGetFrameStep(void)
+{
+    return iocs->frameStep;
+}
+
+// このフレームの残りの時間（ミリ秒）を取得する
+//
+int IocsGetFrameIdle(void)
+{
+    // Playdate の取得
+    PlaydateAPI *playdate = IocsGetPlaydate();
+    if (playdate == NULL) {
+        return 0;
+    }
+
+    // フレームの開始からの経過時間
+    int elapsed = (int)(playdate->system->getElapsedTime() * 1000000.0f);
+    int idle = (kIocsFrameMicrosecond - elapsed) / 1000;
+    return idle > 0 ? idle : 0;
+}
+
+// 描画の補間値（前回のステップから次のステップまでの 0.0 〜 1.0）を取得する
+//
+float IocsGetFrameAlpha(void)
+{
+    return iocs->frameAlpha;
+}
+
+// メモリを初期化する
+//
+static void IocsInitializeMemory(void)
+{
+    memset(&iocs->memory, 0, sizeof (struct IocsMemory));
+}
+
+// タグ付きでメモリを確保／再確保／解放する
+//
+// IOCS_MEMORY_TRACE を定義したときは先頭にヘッダを付けて、タグごとの使用量を計測する
+// 定義しないときは system->realloc をそのまま呼ぶ
+//
+void *IocsRealloc(IocsMemoryTag tag, void *pointer, size_t size)
+{
+    // Playdate の取得
+    PlaydateAPI *playdate = IocsGetPlaydate();
+    if (playdate == NULL) {
+        return NULL;
+    }
+
+#ifdef IOCS_MEMORY_TRACE
+    // 確保済みのメモリの計測を外す
+    struct IocsMemoryHeader *header = NULL;
+    if (pointer != NULL) {
+        header = (struct IocsMemoryHeader *)pointer - 1;
+        IocsCountMemory((IocsMemoryTag)header->tag, -(int)header->size, -1);
+    }
+
+    // 解放
+    if (size == 0) {
+        if (header != NULL) {
+            playdate->system->realloc(header, 0);
+        }
+        return NULL;
+    }
+
+    // 確保
+    struct IocsMemoryHeader *result = (struct IocsMemoryHeader *)playdate->system->realloc(header, sizeof (struct IocsMemoryHeader) + size);
+    if (result == NULL) {
+        if (header != NULL) {
+            IocsCountMemory((IocsMemoryTag)header->tag, (int)header->size, 1);
+        }
+        return NULL;
+    }
+    result->size = (uint32_t)size;
+    result->tag = (uint32_t)tag;
+    IocsCountMemory(tag, (int)size, 1);
+    ++iocs->memory.frameCounts[tag];
+    ++iocs->memory.frameCount;
+    return result + 1;
+#else
+    return playdate->system->realloc(pointer, size);
+#endif
+}
+
+// メモリの使用量を加算する
+//
+static void IocsCountMemory(IocsMemoryTag tag, int byte, int count)
+{
+    struct IocsMemory *memory = &iocs->memory;
+    memory->liveBytes[tag] += byte;
+    memory->liveCounts[tag] += count;
+    memory->liveByte += byte;
+    if (memory->peakBytes[tag] < memory->liveBytes[tag]) {
+        memory->peakBytes[tag] = memory->liveBytes[tag];
+    }
+    if (memory->peakByte < memory->liveByte) {
+        memory->peakByte = memory->liveByte;
+    }
+}
+
+// メモリの使用量を取得する
+//
+const struct IocsMemory *IocsGetMemory(void)
+{
+    return &iocs->memory;
+}
+
+// 現在のメモリの使用量を記録する
+//
+void IocsMarkMemory(void)
+{
+    memcpy(iocs->memory.markBytes, iocs->memory.liveBytes, sizeof (iocs->memory.markBytes));
+    memcpy(iocs->memory.markCounts, iocs->memory.liveCounts, sizeof (iocs->memory.markCounts));
+}
+
+// 記録の外に持ち越す確保を開始する
+//
+// 次のシーンのための先読みのように、記録したときのシーンに属さない確保や解放を囲む
+//
+void IocsCarryMemoryBegin(void)
+{
+#ifdef IOCS_MEMORY_TRACE
+    memcpy(iocs->memory.carryBytes, iocs->memory.liveBytes, sizeof (iocs->memory.carryBytes));
+    memcpy(iocs->memory.carryCounts, iocs->memory.liveCounts, sizeof (iocs->memory.carryCounts));
+#endif
+}
+
+// 記録の外に持ち越す確保を終了する
+//
+void IocsCarryMemoryEnd(void)
+{
+#ifdef IOCS_MEMORY_TRACE
+    for (int i = 0; i < kIocsMemoryTagSize; i++) {
+        iocs->memory.markBytes[i] += iocs->memory.liveBytes[i] - iocs->memory.carryBytes[i];
+        iocs->memory.markCounts[i] += iocs->memory.liveCounts[i] - iocs->memory.carryCounts[i];
+    }
+#endif
+}
+
+// 記録したときから解放されずに残ったメモリを報告する
+//
+void IocsReportMemory(void)
+{
+    // Playdate の取得
+    PlaydateAPI *playdate = IocsGetPlaydate();
+    if (playdate == NULL) {
+        return;
+    }
+
+#ifdef IOCS_MEMORY_TRACE
+    // タグごとの報告
+    const struct IocsMemory *memory = &iocs->memory;
+    for (int i = 0; i < kIocsMemoryTagSize; i++) {
+        int byte = memory->liveBytes[i] - memory->markBytes[i];
+        int count = memory->liveCounts[i] - memory->markCounts[i];
+        if (byte != 0 || count != 0) {
+            playdate->system->logToConsole("%s: %d: memory leak: %s: %d bytes, %d blocks.", __FILE__, __LINE__, memoryTagNames[i], byte, count);
+        }
+    }
+    playdate->system->logToConsole("%s: %d: memory: live %d bytes, peak %d bytes.", __FILE__, __LINE__, memory->liveByte, memory->peakByte);
+#endif
+}
+
+// メモリの使用量を表示する
+//
+static void IocsPrintMemory(int x, int y)
+{
+    // Playdate の取得
+    PlaydateAPI *playdate = IocsGetPlaydate();
+    if (playdate == NULL) {
+        return;
+    }
+
+    // 使用量の表示
+    {
+        char *text;
+        playdate->system->formatString(&text, "%7d %7d %3d", iocs->memory.liveByte, iocs->memory.peakByte, iocs->memory.frameCount);
+        playdate->graphics->setFont(iocs->fonts[kIocsFontSystem]);
+        playdate->graphics->setDrawMode(kDrawModeXOR);
+        playdate->graphics->drawText(text, strlen(text), kUTF8Encoding, x, y);
+        playdate->system->realloc(text, 0);
+    }
+}
+
 // フォントを初期化する
 //
 static void IocsInitializeFont(void)
@@ -202,6 +543,11 @@ static void IocsInitializeFont(void)
         return;
     }
 
+    // テキストのキャッシュの初期化
+    iocs->textCacheSize = 0;
+    iocs->textCacheByte = 0;
+    iocs->textCacheUse = 0;
+
     // フォントの読み込み
     const char *error;
     for (int i = 0; i < kIocsFontSize; i++) {
@@ -251,10 +597,154 @@ int IocsGetTextWidth(IocsFont font, const char *text)
         return 0;
     }
 
+    // キャッシュの幅の取得
+    int cache = IocsFindTextCache(font, text);
+    if (cache != kIocsTextCacheNull) {
+        return iocs->textCaches[cache].width;
+    }
+
     // テキストの長さの取得
     return playdate->graphics->getTextWidth(iocs->fonts[font], text, strlen(text), kUTF8Encoding, 0);
 }
 
+// テキストを描画する（描画済みのビットマップがあれば 1 回の転送で済ませる）
+//
+void IocsDrawText(IocsFont font, const char *text, int x, int y, LCDBitmapDrawMode mode)
+{
+    // Playdate の取得
+    PlaydateAPI *playdate = IocsGetPlaydate();
+    if (playdate == NULL) {
+        return;
+    }
+
+    // キャッシュできないテキストは記録済みのコマンドを発行してからそのまま描画する
+    int cache = IocsFindTextCache(font, text);
+    if (cache == kIocsTextCacheNull) {
+        IocsSubmitDraw();
+        if (iocs->drawClip != kIocsDrawClipNull) {
+            struct IocsDrawClip *clip = &iocs->drawClips[iocs->drawClip];
+            playdate->graphics->setClipRect(clip->x, clip->y, clip->width, clip->height);
+        }
+        playdate->graphics->setDrawMode(mode);
+        playdate->graphics->setFont(iocs->fonts[font]);
+        playdate->graphics->drawText(text, strlen(text), kUTF8Encoding, x, y);
+        playdate->graphics->setDrawMode(kDrawModeCopy);
+        playdate->graphics->clearClipRect();
+        return;
+    }
+
+    // ビットマップの作成
+    struct IocsTextCache *c = &iocs->textCaches[cache];
+    if (c->bitmap == NULL && c->width > 0) {
+        int byte = ((c->width + 31) / 32) * 4 * c->height * 2;
+        IocsTrimTextCache(kIocsTextCacheByte - byte);
+        c->bitmap = playdate->graphics->newBitmap(c->width, c->height, kColorClear);
+        if (c->bitmap != NULL) {
+            playdate->graphics->pushContext(c->bitmap);
+            playdate->graphics->setDrawMode(kDrawModeCopy);
+            playdate->graphics->setFont(iocs->fonts[font]);
+            playdate->graphics->drawText(text, strlen(text), kUTF8Encoding, 0, 0);
+            playdate->graphics->popContext();
+            c->byte = byte;
+            iocs->textCacheByte += byte;
+        }
+    }
+
+    // ビットマップの描画
+    if (c->bitmap != NULL) {
+        IocsDrawBitmap(c->bitmap, x, y, c->width, c->height, mode, kBitmapUnflipped);
+    }
+}
+
+// テキストのキャッシュを検索する（なければ幅を測って登録する）
+//
+static int IocsFindTextCache(IocsFont font, const char *text)
+{
+    // Playdate の取得
+    PlaydateAPI *playdate = IocsGetPlaydate();
+    if (playdate == NULL) {
+        return kIocsTextCacheNull;
+    }
+
+    // ハッシュの計算（FNV-1a）
+    uint32_t hash = 2166136261u;
+    int length = 0;
+    while (text[length] != '\0') {
+        hash = (hash ^ (unsigned char)text[length]) * 16777619u;
+        ++length;
+    }
+    if (length >= kIocsTextCacheTextSize) {
+        return kIocsTextCacheNull;
+    }
+
+    // キャッシュの検索
+    for (int i = 0; i < iocs->textCacheSize; i++) {
+        struct IocsTextCache *c = &iocs->textCaches[i];
+        if (c->hash == hash && c->font == font && strcmp(c->text, text) == 0) {
+            c->use = ++iocs->textCacheUse;
+            return i;
+        }
+    }
+
+    // 登録先の決定（いっぱいなら最も古く使われたものを捨てる）
+    int cache = iocs->textCacheSize;
+    if (cache < kIocsTextCacheSize) {
+        ++iocs->textCacheSize;
+    } else {
+        cache = 0;
+        for (int i = 1; i < kIocsTextCacheSize; i++) {
+            if ((int32_t)(iocs->textCaches[i].use - iocs->textCaches[cache].use) < 0) {
+                cache = i;
+            }
+        }
+        if (iocs->textCaches[cache].bitmap != NULL) {
+            IocsSubmitDraw();
+            playdate->graphics->freeBitmap(iocs->textCaches[cache].bitmap);
+            iocs->textCacheByte -= iocs->textCaches[cache].byte;
+        }
+    }
+
+    // キャッシュの登録
+    struct IocsTextCache *c = &iocs->textCaches[cache];
+    c->font = font;
+    c->hash = hash;
+    memcpy(c->text, text, length + 1);
+    c->width = playdate->graphics->getTextWidth(iocs->fonts[font], text, length, kUTF8Encoding, 0);
+    c->height = playdate->graphics->getFontHeight(iocs->fonts[font]);
+    c->bitmap = NULL;
+    c->byte = 0;
+    c->use = ++iocs->textCacheUse;
+    return cache;
+}
+
+// 描画済みのビットマップを古く使われたものから捨てて指定したバイト数以下にする
+//
+static void IocsTrimTextCache(int byte)
+{
+    // Playdate の取得
+    PlaydateAPI *playdate = IocsGetPlaydate();
+    if (playdate == NULL) {
+        return;
+    }
+
+    // ビットマップの解放
+    while (iocs->textCacheByte > byte) {
+        int cache = kIocsTextCacheNull;
+        for (int i = 0; i < iocs->textCacheSize; i++) {
+            if (iocs->textCaches[i].bitmap != NULL && (cache == kIocsTextCacheNull || (int32_t)(iocs->textCaches[i].use - iocs->textCaches[cache].use) < 0)) {
+                cache = i;
+            }
+        }
+        if (cache == kIocsTextCacheNull) {
+            break;
+        }
+        IocsSubmitDraw();
+        playdate->graphics->freeBitmap(iocs->textCaches[cache].bitmap);
+        iocs->textCaches[cache].bitmap = NULL;
+        iocs->textCacheByte -= iocs->textCaches[cache].byte;
+        iocs->textCaches[cache].byte = 0;
+    }
+}
 
 // 画面を初期化する
 //
@@ -274,6 +764,10 @@ static void IocsInitializeScreen(void)
 
     // 画面の初期化
     iocs->screenColor = kColorBlack;
+
+    // 描画コマンドの初期化
+    iocs->drawCommandSize = 0;
+    IocsResetDraw();
 }
 
 // 画面の色を設定する
@@ -301,71 +795,426 @@ void IocsClearScreen(void)
     if (iocs->screenColor != kColorClear) {
         playdate->graphics->clear(iocs->screenColor);
     }
+
+    // 描画コマンドのリセット
+    IocsResetDraw();
 }
 
-// ボタンを初期化する
+// フレームの描画コマンドの状態をリセットする
 //
-static void IocsInitializeButton(void)
+static void IocsResetDraw(void)
 {
-    // Playdate の取得
-    PlaydateAPI *playdate = IocsGetPlaydate();
-    if (playdate == NULL) {
-        return;
-    }
+    iocs->drawClipSize = 1;
+    iocs->drawClip = kIocsDrawClipNull;
+    iocs->drawOrder = 0;
+    iocs->drawCount = 0;
+    iocs->drawCullCount = 0;
+    iocs->drawModeCount = 0;
+    iocs->drawClipCount = 0;
+}
 
-    // ボタンの初期化
-    iocs->buttonPush = 0;
-    iocs->buttonEdge = 0;
-    iocs->buttonRepeat = 0;
-    for (int i = 0; i < kIocsButtonSize; i++) {
-        iocs->buttonRepeatCounts[i] = 0;
-    }
-    iocs->buttonRepeatCountDelay = 15;
-    iocs->buttonRepeatCountInterval = 1;
-    
+// 描画順を設定する
+//
+void IocsSetDrawOrder(int order)
+{
+    iocs->drawOrder = order < 0 ? 0 : (order < kIocsDrawOrderSize ? order : kIocsDrawOrderSize - 1);
 }
 
-// ボタンを更新する
+// クリップを設定する
 //
-static void IocsUpdateButton(void)
+void IocsSetDrawClip(int x, int y, int width, int height)
 {
-    // Playdate の取得
-    PlaydateAPI *playdate = IocsGetPlaydate();
-    if (playdate == NULL) {
-        return;
+    // 同じクリップを探す
+    int clip = 1;
+    while (clip < iocs->drawClipSize) {
+        struct IocsDrawClip *c = &iocs->drawClips[clip];
+        if (c->x == x && c->y == y && c->width == width && c->height == height) {
+            break;
+        }
+        ++clip;
     }
 
-    // ボタンの取得
-    PDButtons current, pushed;
-    playdate->system->getButtonState(&current, &pushed, NULL);
-    iocs->buttonPush = current;
-    iocs->buttonEdge = pushed;
-    iocs->buttonRepeat = 0;
-
-    // リピートの更新
-    for (int i = 0; i < kIocsButtonSize; i++) {
-        if ((iocs->buttonPush & (1 << i)) != 0) {
-            ++iocs->buttonRepeatCounts[i];
-            if (iocs->buttonRepeatCounts[i] > iocs->buttonRepeatCountDelay + iocs->buttonRepeatCountInterval) {
-                iocs->buttonRepeatCounts[i] = iocs->buttonRepeatCountDelay;
-            }
-            if (iocs->buttonRepeatCounts[i] == 1 || iocs->buttonRepeatCounts[i] == iocs->buttonRepeatCountDelay) {
-                iocs->buttonRepeat |= (1 << i);
-            }
-        } else {
-            iocs->buttonRepeatCounts[i] = 0;
+    // クリップの登録（いっぱいなら記録済みのコマンドを発行して空ける）
+    if (clip >= iocs->drawClipSize) {
+        if (iocs->drawClipSize >= kIocsDrawClipSize) {
+            IocsSubmitDraw();
+            iocs->drawClipSize = 1;
         }
+        clip = iocs->drawClipSize++;
+        iocs->drawClips[clip].x = x;
+        iocs->drawClips[clip].y = y;
+        iocs->drawClips[clip].width = width;
+        iocs->drawClips[clip].height = height;
     }
+    iocs->drawClip = clip;
 }
 
-// ボタンを取得する
+// クリップを解除する
 //
-bool IocsIsButtonPush(PDButtons button)
+void IocsClearDrawClip(void)
 {
-    return (iocs->buttonPush & button) != 0 ? true : false;
+    iocs->drawClip = kIocsDrawClipNull;
 }
-bool IocsIsButtonEdge(PDButtons button)
-{
+
+// 矩形が画面とクリップの中に入るかどうかを判定する（入らなければカリングした数に加える）
+//
+bool IocsIsDrawVisible(int left, int top, int right, int bottom)
+{
+    int clipLeft = 0;
+    int clipTop = 0;
+    int clipRight = LCD_COLUMNS;
+    int clipBottom = LCD_ROWS;
+    if (iocs->drawClip != kIocsDrawClipNull) {
+        struct IocsDrawClip *clip = &iocs->drawClips[iocs->drawClip];
+        clipLeft = clip->x;
+        clipTop = clip->y;
+        clipRight = clip->x + clip->width;
+        clipBottom = clip->y + clip->height;
+    }
+    if (right <= clipLeft || left >= clipRight || bottom <= clipTop || top >= clipBottom) {
+        ++iocs->drawCullCount;
+        return false;
+    }
+    return true;
+}
+
+// ビットマップの描画を記録する
+//
+void IocsDrawBitmap(LCDBitmap *bitmap, int x, int y, int width, int height, LCDBitmapDrawMode mode, LCDBitmapFlip flip)
+{
+    struct IocsDrawCommand *command = IocsAddDrawCommand(kIocsDrawBitmap, x, y, x + width, y + height, mode);
+    if (command != NULL) {
+        command->flip = flip;
+        command->x = x;
+        command->y = y;
+        command->bitmap = bitmap;
+    }
+}
+
+// 回転と拡大をするビットマップの描画を記録する
+//
+void IocsDrawRotatedBitmap(LCDBitmap *bitmap, int x, int y, int width, int height, float degrees, float centerx, float centery, float xscale, float yscale, LCDBitmapDrawMode mode)
+{
+    // 描画される範囲（回転するときはどの向きでも収まる範囲）
+    float w = width * (xscale >= 0.0f ? xscale : -xscale);
+    float h = height * (yscale >= 0.0f ? yscale : -yscale);
+    int left, top, right, bottom;
+    if (degrees == 0.0f) {
+        left = x - (int)(centerx * w) - 1;
+        top = y - (int)(centery * h) - 1;
+        right = left + (int)w + 2;
+        bottom = top + (int)h + 2;
+    } else {
+        int radius = (int)(w + h) + 1;
+        left = x - radius;
+        top = y - radius;
+        right = x + radius;
+        bottom = y + radius;
+    }
+
+    // コマンドの記録
+    struct IocsDrawCommand *command = IocsAddDrawCommand(kIocsDrawRotatedBitmap, left, top, right, bottom, mode);
+    if (command != NULL) {
+        command->x = x;
+        command->y = y;
+        command->bitmap = bitmap;
+        command->degrees = degrees;
+        command->centerX = centerx;
+        command->centerY = centery;
+        command->scaleX = xscale;
+        command->scaleY = yscale;
+    }
+}
+
+// 矩形の描画を記録する
+//
+void IocsDrawRect(int x, int y, int width, int height, LCDColor color)
+{
+    struct IocsDrawCommand *command = IocsAddDrawCommand(kIocsDrawRect, x, y, x + width, y + height, kDrawModeCopy);
+    if (command != NULL) {
+        command->x = x;
+        command->y = y;
+        command->width = width;
+        command->height = height;
+        command->color = color;
+    }
+}
+void IocsFillRect(int x, int y, int width, int height, LCDColor color)
+{
+    struct IocsDrawCommand *command = IocsAddDrawCommand(kIocsDrawFillRect, x, y, x + width, y + height, kDrawModeCopy);
+    if (command != NULL) {
+        command->x = x;
+        command->y = y;
+        command->width = width;
+        command->height = height;
+        command->color = color;
+    }
+}
+
+// 描画コマンドを追加する（画面やクリップの外なら NULL を返す）
+//
+static struct IocsDrawCommand *IocsAddDrawCommand(IocsDrawType type, int left, int top, int right, int bottom, LCDBitmapDrawMode mode)
+{
+    // 画面とクリップの外は描画しない
+    if (!IocsIsDrawVisible(left, top, right, bottom)) {
+        return NULL;
+    }
+
+    // バッファがいっぱいなら記録済みのコマンドを発行する
+    if (iocs->drawCommandSize >= kIocsDrawCommandSize) {
+        IocsSubmitDraw();
+    }
+
+    // コマンドの追加（キーは描画順、クリップ、描画モード、記録順）
+    int index = iocs->drawCommandSize++;
+    struct IocsDrawCommand *command = &iocs->drawCommands[index];
+    command->type = (unsigned char)type;
+    command->mode = (unsigned char)mode;
+    command->clip = (unsigned char)iocs->drawClip;
+    iocs->drawKeys[index] = 
+        ((uint32_t)iocs->drawOrder << kIocsDrawKeyOrderShift) | 
+        ((uint32_t)iocs->drawClip << kIocsDrawKeyClipShift) | 
+        ((uint32_t)mode << kIocsDrawKeyModeShift) | 
+        (uint32_t)index;
+    ++iocs->drawCount;
+    return command;
+}
+
+// 記録した描画コマンドを並べ替えて発行する
+//
+void IocsSubmitDraw(void)
+{
+    // Playdate の取得
+    PlaydateAPI *playdate = IocsGetPlaydate();
+    if (playdate == NULL) {
+        return;
+    }
+
+    // キーで並べ替える（描画順に記録されるのでほとんど並んでいる）
+    uint32_t *keys = iocs->drawKeys;
+    for (int i = 1; i < iocs->drawCommandSize; i++) {
+        uint32_t key = keys[i];
+        int j = i;
+        while (j > 0 && keys[j - 1] > key) {
+            keys[j] = keys[j - 1];
+            --j;
+        }
+        keys[j] = key;
+    }
+
+    // 状態が変わるときだけ設定して描画する
+    int clip = -1;
+    int mode = -1;
+    for (int i = 0; i < iocs->drawCommandSize; i++) {
+        struct IocsDrawCommand *command = &iocs->drawCommands[keys[i] & kIocsDrawKeyIndexMask];
+
+        // クリップの設定
+        if (command->clip != clip) {
+            clip = command->clip;
+            if (clip == kIocsDrawClipNull) {
+                playdate->graphics->clearClipRect();
+            } else {
+                struct IocsDrawClip *c = &iocs->drawClips[clip];
+                playdate->graphics->setClipRect(c->x, c->y, c->width, c->height);
+            }
+            ++iocs->drawClipCount;
+        }
+
+        // ビットマップの描画
+        if (command->type == kIocsDrawBitmap || command->type == kIocsDrawRotatedBitmap) {
+            if (command->mode != mode) {
+                mode = command->mode;
+                playdate->graphics->setDrawMode((LCDBitmapDrawMode)mode);
+                ++iocs->drawModeCount;
+            }
+            if (command->type == kIocsDrawBitmap) {
+                playdate->graphics->drawBitmap(command->bitmap, command->x, command->y, (LCDBitmapFlip)command->flip);
+            } else {
+                playdate->graphics->drawRotatedBitmap(command->bitmap, command->x, command->y, command->degrees, command->centerX, command->centerY, command->scaleX, command->scaleY);
+            }
+
+        // 矩形の描画
+        } else if (command->type == kIocsDrawRect) {
+            playdate->graphics->drawRect(command->x, command->y, command->width, command->height, command->color);
+        } else if (command->type == kIocsDrawFillRect) {
+            playdate->graphics->fillRect(command->x, command->y, command->width, command->height, command->color);
+        }
+    }
+
+    // 状態を戻す
+    if (clip > kIocsDrawClipNull) {
+        playdate->graphics->clearClipRect();
+    }
+    if (mode > kDrawModeCopy) {
+        playdate->graphics->setDrawMode(kDrawModeCopy);
+    }
+    iocs->drawCommandSize = 0;
+}
+
+// 描画の統計を表示する
+//
+static void IocsPrintDraw(int x, int y)
+{
+    // Playdate の取得
+    PlaydateAPI *playdate = IocsGetPlaydate();
+    if (playdate == NULL) {
+        return;
+    }
+
+    // 統計の表示
+    {
+        char *text;
+        playdate->system->formatString(&text, "%3d %3d %2d %2d", iocs->drawCount, iocs->drawCullCount, iocs->drawModeCount, iocs->drawClipCount);
+        playdate->graphics->setFont(iocs->fonts[kIocsFontSystem]);
+        playdate->graphics->setDrawMode(kDrawModeXOR);
+        playdate->graphics->drawText(text, strlen(text), kUTF8Encoding, x, y);
+        playdate->system->realloc(text, 0);
+    }
+}
+
+// ボタンを初期化する
+//
+static void IocsInitializeButton(void)
+{
+    // Playdate の取得
+    PlaydateAPI *playdate = IocsGetPlaydate();
+    if (playdate == NULL) {
+        return;
+    }
+
+    // ボタンの初期化
+    iocs->buttonPush = 0;
+    iocs->buttonEdge = 0;
+    iocs->buttonRepeat = 0;
+    for (int i = 0; i < kIocsButtonSize; i++) {
+        iocs->buttonRepeatCounts[i] = 0;
+    }
+    iocs->buttonRepeatCountDelay = 15;
+    iocs->buttonRepeatCountInterval = 1;
+
+    // イベントの初期化
+    iocs->buttonEventHead = 0;
+    iocs->buttonEventTail = 0;
+    iocs->buttonEventLost = 0;
+    iocs->buttonEventSize = 0;
+    playdate->system->setButtonCallback(IocsButtonCallback, iocs, kIocsButtonEventSize);
+    
+}
+
+// ボタンを更新する
+//
+static void IocsUpdateButton(void)
+{
+    // Playdate の取得
+    PlaydateAPI *playdate = IocsGetPlaydate();
+    if (playdate == NULL) {
+        return;
+    }
+
+    // 2 回目以降のステップは押されているボタンをそのままにして、同じ押下を新たなエッジとしない
+    if (iocs->frameStepBegin > 0) {
+        iocs->buttonEdge = 0;
+        iocs->buttonEventSize = 0;
+        return;
+    }
+
+    // ボタンの取得（ハードウェアとイベントはフレームに 1 回だけ読む）
+    PDButtons current, pushed;
+    playdate->system->getButtonState(&current, &pushed, NULL);
+
+    // 前回からのイベントの取り出し（フレーム内で押して離されたボタンも押されたものとする）
+    iocs->buttonEventSize = 0;
+    while (iocs->buttonEventTail != iocs->buttonEventHead) {
+        const struct IocsButtonEvent *event = &iocs->buttonEventRing[iocs->buttonEventTail & kIocsButtonEventMask];
+        iocs->buttonEvents[iocs->buttonEventSize++] = *event;
+        if (event->down) {
+            pushed |= event->button;
+        }
+        ++iocs->buttonEventTail;
+    }
+    if (iocs->buttonEventLost > 0) {
+        playdate->system->logToConsole("%s: %d: %d button events are lost.", __FILE__, __LINE__, iocs->buttonEventLost);
+        iocs->buttonEventLost = 0;
+    }
+    iocs->buttonPush = current;
+    iocs->buttonEdge = pushed;
+}
+
+// ボタンのイベントを受け取る（userdata は入出力制御システム）
+//
+static int IocsButtonCallback(PDButtons button, int down, uint32_t when, void *userdata)
+{
+    // リングバッファがいっぱいなら新しいイベントを捨てる（書き込みは head だけを進める）
+    struct Iocs *self = (struct Iocs *)userdata;
+    if (self->buttonEventHead - self->buttonEventTail >= kIocsButtonEventSize) {
+        ++self->buttonEventLost;
+    } else {
+        struct IocsButtonEvent *event = &self->buttonEventRing[self->buttonEventHead & kIocsButtonEventMask];
+        event->button = button;
+        event->down = down != 0 ? true : false;
+        event->when = when;
+        ++self->buttonEventHead;
+    }
+    return 0;
+}
+
+// このフレームのボタンのイベントを追加する
+//
+static void IocsAddButtonEvent(PDButtons button, bool down, uint32_t when)
+{
+    if (iocs->buttonEventSize < kIocsButtonEventSize) {
+        struct IocsButtonEvent *event = &iocs->buttonEvents[iocs->buttonEventSize++];
+        event->button = button;
+        event->down = down;
+        event->when = when;
+    }
+}
+
+// ボタンの状態からこのフレームのイベントを作り直す
+//
+static void IocsSynthesizeButtonEvents(PDButtons previous, PDButtons push, PDButtons edge)
+{
+    iocs->buttonEventSize = 0;
+    for (int i = 0; i < kIocsButtonSize; i++) {
+        PDButtons button = (PDButtons)(1 << i);
+        if ((edge & button) != 0) {
+            IocsAddButtonEvent(button, true, 0);
+        }
+        if (((previous | edge) & button) != 0 && (push & button) == 0) {
+            IocsAddButtonEvent(button, false, 0);
+        }
+    }
+}
+
+// ボタンのリピートを更新する
+//
+static void IocsUpdateButtonRepeat(void)
+{
+    // リピートの更新
+    iocs->buttonRepeat = 0;
+    for (int i = 0; i < kIocsButtonSize; i++) {
+        if ((iocs->buttonPush & (1 << i)) != 0) {
+            ++iocs->buttonRepeatCounts[i];
+            if (iocs->buttonRepeatCounts[i] > iocs->buttonRepeatCountDelay + iocs->buttonRepeatCountInterval) {
+                iocs->buttonRepeatCounts[i] = iocs->buttonRepeatCountDelay;
+            }
+            if (iocs->buttonRepeatCounts[i] == 1 || iocs->buttonRepeatCounts[i] == iocs->buttonRepeatCountDelay) {
+                iocs->buttonRepeat |= (1 << i);
+            }
+        } else {
+            iocs->buttonRepeatCounts[i] = 0;
+        }
+    }
+}
+
+// ボタンを取得する
+//
+bool IocsIsButtonPush(PDButtons button)
+{
+    return (iocs->buttonPush & button) != 0 ? true : false;
+}
+bool IocsIsButtonEdge(PDButtons button)
+{
     return (iocs->buttonEdge & button) != 0 ? true : false;
 }
 bool IocsIsButtonRepeat(PDButtons button)
@@ -373,6 +1222,17 @@ bool IocsIsButtonRepeat(PDButtons button)
     return (iocs->buttonRepeat & button) != 0 ? true : false;
 }
 
+// このフレームのボタンのイベントを順に取得する
+//
+const struct IocsButtonEvent *IocsFindButtonEvent(void)
+{
+    return iocs->buttonEventSize > 0 ? &iocs->buttonEvents[0] : NULL;
+}
+const struct IocsButtonEvent *IocsNextButtonEvent(const struct IocsButtonEvent *event)
+{
+    return event + 1 < &iocs->buttonEvents[iocs->buttonEventSize] ? event + 1 : NULL;
+}
+
 // ボタンの状態を表示する
 //
 static void IocsPrintButton(int x, int y, PDButtons button)
@@ -519,6 +1379,13 @@ static void IocsInitializeAudio(void)
     {
         for (int i = 0; i < kIocsAudioEffectSampleSize; i++) {
             iocs->audioEffectSamples[i] = NULL;
+            iocs->audioEffectPaths[i][0] = '\0';
+            iocs->audioEffectReferences[i] = 0;
+            iocs->audioEffectIdles[i] = 0;
+            iocs->audioEffectBytes[i] = 0;
+            iocs->audioEffectFrames[i] = 0;
+            iocs->audioEffectPriorities[i] = kIocsAudioEffectPriorityDefault;
+            iocs->audioEffectLimits[i] = kIocsAudioEffectPlayerSize;
         }
         for (int i = 0; i < kIocsAudioEffectPlayerSize; i++) {
             iocs->audioEffectPlayers[i] = playdate->sound->sampleplayer->newPlayer();
@@ -526,6 +1393,17 @@ static void IocsInitializeAudio(void)
                 playdate->system->error("%s: %d: effect sample player is not created.", __FILE__, __LINE__);
                 return;
             }
+            playdate->sound->sampleplayer->setFinishCallback(iocs->audioEffectPlayers[i], IocsFinishAudioEffect, (void *)(uintptr_t)0);
+            iocs->audioEffectPlayerSamples[i] = -1;
+            iocs->audioEffectPlayerStarts[i] = 0;
+            iocs->audioEffectPlayerFinishes[i] = 0;
+        }
+        iocs->audioEffectPlayerStart = 0;
+        iocs->audioEffectPlayerFree = kIocsAudioEffectPlayerFree;
+        for (int i = 0; i < kIocsAudioBankSize; i++) {
+            iocs->audioBanks[i].name[0] = '\0';
+            iocs->audioBanks[i].reference = 0;
+            iocs->audioBanks[i].sampleSize = 0;
         }
     }
 
@@ -576,9 +1454,197 @@ void IocsStopAudioSystem(void)
     }
 }
 
-// エフェクトオーディオを読み込む
+// オーディオバンクを参照する（初めて参照するときはサンプルを読み込む）
 //
-void IocsLoadAudioEffects(const char *paths[], int size)
+int IocsRetainAudioBank(const char *name, const char *paths[], int size, bool preload)
+{
+    // Playdate の取得
+    PlaydateAPI *playdate = IocsGetPlaydate();
+    if (playdate == NULL) {
+        return kIocsAudioBankNull;
+    }
+
+    // 参照済みのバンク
+    int bank = IocsFindAudioBank(name);
+    if (bank != kIocsAudioBankNull) {
+        ++iocs->audioBanks[bank].reference;
+
+    // バンクの作成
+    } else {
+        if (size > kIocsAudioBankSampleSize) {
+            playdate->system->error("%s: %d: audio bank sample entry is over: %s", __FILE__, __LINE__, name);
+            return kIocsAudioBankNull;
+        }
+        for (int i = 0; i < kIocsAudioBankSize; i++) {
+            if (iocs->audioBanks[i].reference == 0) {
+                bank = i;
+                break;
+            }
+        }
+        if (bank == kIocsAudioBankNull) {
+            playdate->system->error("%s: %d: audio bank entry is over: %s", __FILE__, __LINE__, name);
+            return kIocsAudioBankNull;
+        }
+        struct IocsAudioBank *b = &iocs->audioBanks[bank];
+        strncpy(b->name, name, kIocsAudioBankNameSize - 1);
+        b->name[kIocsAudioBankNameSize - 1] = '\0';
+        b->reference = 1;
+        b->sampleSize = 0;
+        for (int i = 0; i < size; i++) {
+            int sample = IocsRetainAudioEffect(paths[i]);
+            if (sample == kIocsAudioEffectSampleNull) {
+                playdate->system->error("%s: %d: effect audio entry is over.", __FILE__, __LINE__);
+                break;
+            }
+            b->samples[b->sampleSize++] = sample;
+        }
+    }
+
+    // 先読みでなければすぐに読み込む
+    if (!preload) {
+        for (int i = 0; i < iocs->audioBanks[bank].sampleSize; i++) {
+            IocsLoadAudioEffect(iocs->audioBanks[bank].samples[i]);
+        }
+    }
+
+    // 終了
+    return bank;
+}
+
+// オーディオバンクの参照をやめる（どこからも参照されなくなったサンプルは少し後で解放される）
+//
+void IocsReleaseAudioBank(const char *name)
+{
+    int bank = IocsFindAudioBank(name);
+    if (bank != kIocsAudioBankNull) {
+        struct IocsAudioBank *b = &iocs->audioBanks[bank];
+        if (--b->reference == 0) {
+            for (int i = 0; i < b->sampleSize; i++) {
+                int sample = b->samples[i];
+                if (--iocs->audioEffectReferences[sample] == 0) {
+                    iocs->audioEffectIdles[sample] = 0;
+                }
+            }
+            b->name[0] = '\0';
+            b->sampleSize = 0;
+        }
+    }
+}
+
+// オーディオバンクのすべてのサンプルが読み込まれたかどうかを判定する
+//
+bool IocsIsAudioBankLoaded(int bank)
+{
+    bool result = false;
+    if (0 <= bank && bank < kIocsAudioBankSize && iocs->audioBanks[bank].reference > 0) {
+        result = true;
+        for (int i = 0; i < iocs->audioBanks[bank].sampleSize; i++) {
+            if (iocs->audioEffectSamples[iocs->audioBanks[bank].samples[i]] == NULL) {
+                result = false;
+                break;
+            }
+        }
+    }
+    return result;
+}
+
+// オーディオバンクのサンプルを取得する
+//
+int IocsGetAudioBankSample(int bank, int index)
+{
+    return 0 <= bank && bank < kIocsAudioBankSize && 0 <= index && index < iocs->audioBanks[bank].sampleSize ? iocs->audioBanks[bank].samples[index] : kIocsAudioEffectSampleNull;
+}
+
+// オーディオバンクが使っているメモリのバイト数を取得する
+//
+int IocsGetAudioBankByte(int bank)
+{
+    int byte = 0;
+    if (0 <= bank && bank < kIocsAudioBankSize) {
+        for (int i = 0; i < iocs->audioBanks[bank].sampleSize; i++) {
+            byte += iocs->audioEffectBytes[iocs->audioBanks[bank].samples[i]];
+        }
+    }
+    return byte;
+}
+
+// オーディオを更新する
+//
+static void IocsUpdateAudio(void)
+{
+    // 再生の終わったプレイヤを空きにする
+    IocsCollectAudioEffects();
+
+    // 先読み中のサンプルを 1 フレームに 1 つ読み込む
+    for (int i = 0; i < kIocsAudioEffectSampleSize; i++) {
+        if (iocs->audioEffectReferences[i] > 0 && iocs->audioEffectSamples[i] == NULL) {
+            IocsLoadAudioEffect(i);
+            break;
+        }
+    }
+
+    // しばらく参照されなかったサンプルを解放する
+    for (int i = 0; i < kIocsAudioEffectSampleSize; i++) {
+        if (iocs->audioEffectReferences[i] == 0 && iocs->audioEffectPaths[i][0] != '\0') {
+            if (++iocs->audioEffectIdles[i] >= kIocsAudioEffectKeepFrame) {
+                IocsUnloadAudioEffect(i);
+            }
+        }
+    }
+}
+
+// 名前でオーディオバンクを検索する
+//
+static int IocsFindAudioBank(const char *name)
+{
+    for (int i = 0; i < kIocsAudioBankSize; i++) {
+        if (iocs->audioBanks[i].reference > 0 && strncmp(iocs->audioBanks[i].name, name, kIocsAudioBankNameSize - 1) == 0) {
+            return i;
+        }
+    }
+    return kIocsAudioBankNull;
+}
+
+// エフェクトオーディオのサンプルを参照する
+//
+static int IocsRetainAudioEffect(const char *path)
+{
+    // 同じパスのサンプルの検索
+    int sample = kIocsAudioEffectSampleNull;
+    for (int i = 0; i < kIocsAudioEffectSampleSize; i++) {
+        if (strncmp(iocs->audioEffectPaths[i], path, kIocsAudioEffectPathSize - 1) == 0) {
+            sample = i;
+            break;
+        } else if (sample == kIocsAudioEffectSampleNull && iocs->audioEffectPaths[i][0] == '\0') {
+            sample = i;
+        }
+    }
+
+    // 空きがなければ参照されていないサンプルを解放する
+    if (sample == kIocsAudioEffectSampleNull) {
+        for (int i = 0; i < kIocsAudioEffectSampleSize; i++) {
+            if (iocs->audioEffectReferences[i] == 0) {
+                IocsUnloadAudioEffect(i);
+                sample = i;
+                break;
+            }
+        }
+    }
+
+    // 参照の追加
+    if (sample != kIocsAudioEffectSampleNull) {
+        if (iocs->audioEffectPaths[sample][0] == '\0') {
+            strncpy(iocs->audioEffectPaths[sample], path, kIocsAudioEffectPathSize - 1);
+            iocs->audioEffectPaths[sample][kIocsAudioEffectPathSize - 1] = '\0';
+        }
+        ++iocs->audioEffectReferences[sample];
+    }
+    return sample;
+}
+
+// エフェクトオーディオのサンプルを読み込む
+//
+static void IocsLoadAudioEffect(int sample)
 {
     // Playdate の取得
     PlaydateAPI *playdate = IocsGetPlaydate();
@@ -586,42 +1652,43 @@ void IocsLoadAudioEffects(const char *paths[], int size)
         return;
     }
 
+    // 読み込み済み
+    if (iocs->audioEffectSamples[sample] != NULL) {
+        return;
+    }
+
     // オーディオの読み込み
-    if (size > kIocsAudioEffectSampleSize) {
-        playdate->system->error("%s: %d: effect audio entry is over.", __FILE__, __LINE__);
+    const char *path = iocs->audioEffectPaths[sample];
+    iocs->audioEffectSamples[sample] = playdate->sound->sample->load(path);
+    if (iocs->audioEffectSamples[sample] == NULL) {
+        playdate->system->error("%s: %d: effect audio sample is not loaded: %s", __FILE__, __LINE__, path);
         return;
     }
-    for (int i = 0; i < size; i++) {
-        iocs->audioEffectSamples[i] = playdate->sound->sample->load(paths[i]);
-        if (iocs->audioEffectSamples[i] == NULL) {
-            playdate->system->error("%s: %d: effect audio sample is not loaded: %s", __FILE__, __LINE__, paths[i]);
-            return;
-        }
-        {
-            uint8_t *data;
-            SoundFormat format;
-            uint32_t samplerate;
-            uint32_t bytelength;
-            playdate->sound->sample->getData(iocs->audioEffectSamples[i], &data, &format, &samplerate, &bytelength);
-            iocs->audioEffectFrames[i] = bytelength / SoundFormat_bytesPerFrame(format);
-            playdate->system->logToConsole(
-                "%s: %d: %s: %d, %d, %d, %d, %f", 
-                __FILE__, 
-                __LINE__, 
-                paths[i], 
-                format, 
-                samplerate, 
-                bytelength, 
-                iocs->audioEffectFrames[i], 
-                (double)playdate->sound->sample->getLength(iocs->audioEffectSamples[i])
-            );
-        }
+    {
+        uint8_t *data;
+        SoundFormat format;
+        uint32_t samplerate;
+        uint32_t bytelength;
+        playdate->sound->sample->getData(iocs->audioEffectSamples[sample], &data, &format, &samplerate, &bytelength);
+        iocs->audioEffectBytes[sample] = bytelength;
+        iocs->audioEffectFrames[sample] = bytelength / SoundFormat_bytesPerFrame(format);
+        playdate->system->logToConsole(
+            "%s: %d: %s: %d, %d, %d, %d, %f", 
+            __FILE__, 
+            __LINE__, 
+            path, 
+            format, 
+            samplerate, 
+            bytelength, 
+            iocs->audioEffectFrames[sample], 
+            (double)playdate->sound->sample->getLength(iocs->audioEffectSamples[sample])
+        );
     }
 }
 
-// エフェクトオーディオを解放する
+// エフェクトオーディオのサンプルを解放する
 //
-void IocsUnloadAllAudioEffects(void)
+static void IocsUnloadAudioEffect(int sample)
 {
     // Playdate の取得
     PlaydateAPI *playdate = IocsGetPlaydate();
@@ -629,13 +1696,34 @@ void IocsUnloadAllAudioEffects(void)
         return;
     }
 
-    // オーディオの解放
-    for (int i = 0; i < kIocsAudioEffectSampleSize; i++) {
-        if (iocs->audioEffectSamples[i] != NULL) {
-            playdate->sound->sample->freeSample(iocs->audioEffectSamples[i]);
-            iocs->audioEffectSamples[i] = NULL;
+    // 再生中のプレイヤの停止
+    for (int i = 0; i < kIocsAudioEffectPlayerSize; i++) {
+        if ((iocs->audioEffectPlayerFree & (1 << i)) == 0 && iocs->audioEffectPlayerSamples[i] == sample) {
+            IocsStopAudioEffect(i);
         }
     }
+
+    // オーディオの解放
+    if (iocs->audioEffectSamples[sample] != NULL) {
+        playdate->sound->sample->freeSample(iocs->audioEffectSamples[sample]);
+        iocs->audioEffectSamples[sample] = NULL;
+    }
+    iocs->audioEffectPaths[sample][0] = '\0';
+    iocs->audioEffectIdles[sample] = 0;
+    iocs->audioEffectBytes[sample] = 0;
+    iocs->audioEffectFrames[sample] = 0;
+    iocs->audioEffectPriorities[sample] = kIocsAudioEffectPriorityDefault;
+    iocs->audioEffectLimits[sample] = kIocsAudioEffectPlayerSize;
+}
+
+// エフェクトオーディオの優先度と同時に鳴らせる数を設定する
+//
+void IocsSetAudioEffectPriority(int sample, int priority, int limit)
+{
+    if (0 <= sample && sample < kIocsAudioEffectSampleSize) {
+        iocs->audioEffectPriorities[sample] = priority;
+        iocs->audioEffectLimits[sample] = limit > 0 ? limit : 1;
+    }
 }
 
 // エフェクトオーディオを再生する
@@ -645,22 +1733,101 @@ int IocsPlayAudioEffect(int sample, int repeat)
     // Playdate の取得
     PlaydateAPI *playdate = IocsGetPlaydate();
     if (playdate == NULL) {
-        return -1;
+        return kIocsAudioEffectPlayerNull;
+    }
+
+    // 読み込まれていないサンプル
+    if (sample < 0 || sample >= kIocsAudioEffectSampleSize || iocs->audioEffectSamples[sample] == NULL) {
+        return kIocsAudioEffectPlayerNull;
+    }
+
+    // 再生の終わったプレイヤを空きにする
+    IocsCollectAudioEffects();
+
+    // 同じサンプルが上限まで鳴っていれば一番古いものを、空きがあれば空きを、なければ優先度の低いものを使う
+    int player = kIocsAudioEffectPlayerNull;
+    {
+        int count = 0;
+        int oldest = kIocsAudioEffectPlayerNull;
+        for (int i = 0; i < kIocsAudioEffectPlayerSize; i++) {
+            if ((iocs->audioEffectPlayerFree & (1 << i)) == 0 && iocs->audioEffectPlayerSamples[i] == sample) {
+                if (oldest == kIocsAudioEffectPlayerNull || (int32_t)(iocs->audioEffectPlayerStarts[i] - iocs->audioEffectPlayerStarts[oldest]) < 0) {
+                    oldest = i;
+                }
+                ++count;
+            }
+        }
+        if (count >= iocs->audioEffectLimits[sample]) {
+            player = oldest;
+        } else if (iocs->audioEffectPlayerFree != 0) {
+            player = __builtin_ctz(iocs->audioEffectPlayerFree);
+        } else {
+            player = IocsStealAudioEffect(sample);
+        }
     }
 
     // オーディオの再生
-    int player = 0;
-    while (player < kIocsAudioEffectPlayerSize) {
-        if (playdate->sound->sampleplayer->isPlaying(iocs->audioEffectPlayers[player]) == 0) {
-            playdate->sound->sampleplayer->setSample(iocs->audioEffectPlayers[player], iocs->audioEffectSamples[sample]);
-            playdate->sound->sampleplayer->setVolume(iocs->audioEffectPlayers[player], 1.0f, 1.0f);
-            // playdate->sound->sampleplayer->setPlayRange(iocs->audioEffectPlayers[player], 0, iocs->audioEffectFrames[sample]);
-            playdate->sound->sampleplayer->play(iocs->audioEffectPlayers[player], repeat, 1.0f);
+    if (player != kIocsAudioEffectPlayerNull) {
+        SamplePlayer *sampleplayer = iocs->audioEffectPlayers[player];
+        if ((iocs->audioEffectPlayerFree & (1 << player)) == 0) {
+            playdate->sound->sampleplayer->stop(sampleplayer);
+        }
+        iocs->audioEffectPlayerFree &= ~(1 << player);
+        iocs->audioEffectPlayerSamples[player] = sample;
+        iocs->audioEffectPlayerStarts[player] = ++iocs->audioEffectPlayerStart;
+        playdate->sound->sampleplayer->setFinishCallback(sampleplayer, IocsFinishAudioEffect, (void *)(uintptr_t)iocs->audioEffectPlayerStarts[player]);
+        playdate->sound->sampleplayer->setSample(sampleplayer, iocs->audioEffectSamples[sample]);
+        playdate->sound->sampleplayer->setVolume(sampleplayer, 1.0f, 1.0f);
+        // playdate->sound->sampleplayer->setPlayRange(sampleplayer, 0, iocs->audioEffectFrames[sample]);
+        playdate->sound->sampleplayer->play(sampleplayer, repeat, 1.0f);
+    }
+    return player;
+}
+
+// 奪うプレイヤを選ぶ（優先度が同じか低いもののうち、優先度が低く古いもの）
+//
+static int IocsStealAudioEffect(int sample)
+{
+    int player = kIocsAudioEffectPlayerNull;
+    int priority = iocs->audioEffectPriorities[sample];
+    for (int i = 0; i < kIocsAudioEffectPlayerSize; i++) {
+        int p = iocs->audioEffectPriorities[iocs->audioEffectPlayerSamples[i]];
+        if (p <= priority) {
+            if (
+                player == kIocsAudioEffectPlayerNull || 
+                p < iocs->audioEffectPriorities[iocs->audioEffectPlayerSamples[player]] || 
+                (p == iocs->audioEffectPriorities[iocs->audioEffectPlayerSamples[player]] && (int32_t)(iocs->audioEffectPlayerStarts[i] - iocs->audioEffectPlayerStarts[player]) < 0)
+            ) {
+                player = i;
+            }
+        }
+    }
+    return player;
+}
+
+// エフェクトオーディオの再生が終わった（userdata は再生を開始したときの番号）
+//
+static void IocsFinishAudioEffect(SoundSource *source, void *userdata)
+{
+    // オーディオのコールバックからはプレイヤごとの番号を書くだけにして、空きの更新はメインスレッドで行う
+    for (int i = 0; i < kIocsAudioEffectPlayerSize; i++) {
+        if ((SoundSource *)iocs->audioEffectPlayers[i] == source) {
+            iocs->audioEffectPlayerFinishes[i] = (uint32_t)(uintptr_t)userdata;
             break;
         }
-        ++player;
     }
-    return player < kIocsAudioEffectPlayerSize ? player : -1;
+}
+
+// 再生の終わったプレイヤを空きにする
+//
+static void IocsCollectAudioEffects(void)
+{
+    // 停止や奪われた後に再び鳴らしたプレイヤは、古い再生の終了で空きにしない
+    for (int i = 0; i < kIocsAudioEffectPlayerSize; i++) {
+        if ((iocs->audioEffectPlayerFree & (1 << i)) == 0 && iocs->audioEffectPlayerFinishes[i] == iocs->audioEffectPlayerStarts[i]) {
+            iocs->audioEffectPlayerFree |= 1 << i;
+        }
+    }
 }
 
 // エフェクトオーディオを停止する
@@ -675,8 +1842,9 @@ void IocsStopAudioEffect(int player)
 
     // オーディオの停止
     if (0 <= player && player < kIocsAudioEffectPlayerSize) {
-        if (playdate->sound->sampleplayer->isPlaying(iocs->audioEffectPlayers[player]) != 0) {
+        if ((iocs->audioEffectPlayerFree & (1 << player)) == 0) {
             playdate->sound->sampleplayer->stop(iocs->audioEffectPlayers[player]);
+            iocs->audioEffectPlayerFree |= 1 << player;
         }
     }
 }
@@ -690,9 +1858,7 @@ void IocsStopAllAudioEffects(void)
 
     // オーディオの停止
     for (int i = 0; i < kIocsAudioEffectPlayerSize; i++) {
-        if (playdate->sound->sampleplayer->isPlaying(iocs->audioEffectPlayers[i]) != 0) {
-            playdate->sound->sampleplayer->stop(iocs->audioEffectPlayers[i]);
-        }
+        IocsStopAudioEffect(i);
     }
 }
 
@@ -763,35 +1929,398 @@ int IocsGetTextLength(const char *text)
 //
 static void IocsInitializeRandom(void)
 {
-    iocs->xorshift.seed = 2463534242;
+    IocsSetRandomSeed(&iocs->random, 2463534242);
 }
 
 // 乱数の種を初期化する
 //
-void IocsSetRandomSeed(struct XorShift *xorshift, uint32_t seed)
+void IocsSetRandomSeed(struct IocsRandom *random, uint32_t seed)
+{
+    IocsSetRandomStream(random, seed, NULL);
+}
+
+// 名前つきのストリームとして乱数を初期化する（同じ種でも名前が違えば独立した系列になる）
+//
+void IocsSetRandomStream(struct IocsRandom *random, uint32_t seed, const char *name)
 {
-    if (xorshift == NULL) {
-        xorshift = &iocs->xorshift;
+    if (random == NULL) {
+        random = &iocs->random;
     }
-    xorshift->seed = seed;
+    random->key = IocsMakeRandomKey(seed, name);
+    random->counter = 0;
 }
 
 // 乱数を取得する
 //
-int IocsGetRandomNumber(struct XorShift *xorshift)
+int IocsGetRandomNumber(struct IocsRandom *random)
+{
+    if (random == NULL) {
+        random = &iocs->random;
+    }
+    return (int)(IocsGetRandomNumberAt(random, random->counter++) & 0x7fffffff);
+}
+bool IocsGetRandomBool(struct IocsRandom *random)
+{
+    return (IocsGetRandomNumber(random) & 0x10) != 0 ? true : false;
+}
+
+// 指定した番号の乱数を取得する（ストリームの状態は変えない）
+//
+uint32_t IocsGetRandomNumberAt(const struct IocsRandom *random, uint64_t index)
+{
+    return IocsMixRandomAt(random->key, index);
+}
+
+// 乱数を指定した数だけ読み飛ばす
+//
+void IocsSkipRandom(struct IocsRandom *random, uint64_t count)
+{
+    if (random == NULL) {
+        random = &iocs->random;
+    }
+    random->counter += count;
+}
+
+// 乱数をまとめて取得する（各要素は互いに依存しない）
+//
+void IocsFillRandom(struct IocsRandom *random, uint32_t *values, int size)
+{
+    if (random == NULL) {
+        random = &iocs->random;
+    }
+    for (int i = 0; i < size; i++) {
+        values[i] = IocsMixRandomAt(random->key, random->counter + i);
+    }
+    random->counter += size;
+}
+
+// 記録を初期化する
+//
+static void IocsInitializeRecord(void)
+{
+    iocs->recordMode = kIocsRecordNull;
+    iocs->recordFile = NULL;
+    iocs->recordBuffer = NULL;
+    iocs->recordSize = 0;
+    iocs->recordPosition = 0;
+    iocs->recordRun = 0;
+    iocs->recordFrame = 0;
+    iocs->recordPush = 0;
+    iocs->recordCrank = 0;
+}
+
+// 入力の記録を開始する
+//
+bool IocsStartRecord(const char *path)
+{
+    // Playdate の取得
+    PlaydateAPI *playdate = IocsGetPlaydate();
+    if (playdate == NULL) {
+        return false;
+    }
+
+    // 記録の停止
+    IocsStopRecord();
+
+    // ファイルを開く
+    iocs->recordFile = playdate->file->open(path, kFileWrite);
+    if (iocs->recordFile == NULL) {
+        playdate->system->logToConsole("%s: %d: record file is not opened: %s", __FILE__, __LINE__, path);
+        return false;
+    }
+    iocs->recordBuffer = IocsRealloc(kIocsMemoryTagSystem, NULL, kIocsRecordBufferSize);
+    if (iocs->recordBuffer == NULL) {
+        playdate->system->error("%s: %d: record buffer is not created.", __FILE__, __LINE__);
+        playdate->file->close(iocs->recordFile);
+        iocs->recordFile = NULL;
+        return false;
+    }
+
+    // 記録の開始
+    iocs->recordMode = kIocsRecordWrite;
+    iocs->recordSize = 0;
+    iocs->recordRun = 0;
+    iocs->recordFrame = 0;
+    iocs->recordPush = iocs->buttonPush & ((1 << kIocsButtonSize) - 1);
+    iocs->recordCrank = IocsQuantizeCrank(iocs->crankAngle);
+
+    // ヘッダの書き込み
+    IocsPutRecord(kIocsRecordMagic, 4);
+    IocsPutRecord(iocs->recordPush, 1);
+    IocsPutRecord(iocs->recordCrank, 2);
+
+    // 終了
+    return true;
+}
+
+// 入力の再生を開始する
+//
+bool IocsStartReplay(const char *path)
+{
+    // Playdate の取得
+    PlaydateAPI *playdate = IocsGetPlaydate();
+    if (playdate == NULL) {
+        return false;
+    }
+
+    // 記録の停止
+    IocsStopRecord();
+
+    // ファイルの読み込み
+    FileStat stat;
+    if (playdate->file->stat(path, &stat) != 0 || stat.size < kIocsRecordHeaderSize) {
+        playdate->system->logToConsole("%s: %d: record file is not found: %s", __FILE__, __LINE__, path);
+        return false;
+    }
+    iocs->recordBuffer = IocsRealloc(kIocsMemoryTagSystem, NULL, stat.size);
+    if (iocs->recordBuffer == NULL) {
+        playdate->system->error("%s: %d: record buffer is not created.", __FILE__, __LINE__);
+        return false;
+    }
+    SDFile *file = playdate->file->open(path, kFileRead | kFileReadData);
+    if (file != NULL) {
+        iocs->recordSize = playdate->file->read(file, iocs->recordBuffer, stat.size);
+        playdate->file->close(file);
+    }
+    iocs->recordPosition = 0;
+    if (file == NULL || iocs->recordSize != (int)stat.size || IocsGetRecord(4) != kIocsRecordMagic) {
+        playdate->system->logToConsole("%s: %d: record file is not valid: %s", __FILE__, __LINE__, path);
+        IocsRealloc(kIocsMemoryTagSystem, iocs->recordBuffer, 0);
+        IocsInitializeRecord();
+        return false;
+    }
+
+    // 再生の開始
+    iocs->recordMode = kIocsRecordRead;
+    iocs->recordRun = 0;
+    iocs->recordFrame = 0;
+    iocs->recordPush = (PDButtons)IocsGetRecord(1);
+    iocs->recordCrank = (int)IocsGetRecord(2);
+
+    // 終了
+    return true;
+}
+
+// 入力の記録／再生を停止する
+//
+void IocsStopRecord(void)
+{
+    // Playdate の取得
+    PlaydateAPI *playdate = IocsGetPlaydate();
+    if (playdate == NULL) {
+        return;
+    }
+
+    // 記録の書き出し
+    if (iocs->recordMode == kIocsRecordWrite) {
+        if (iocs->recordRun > 0) {
+            IocsPutRecord(kIocsRecordFlagRun | (iocs->recordRun - 1), 1);
+        }
+        IocsFlushRecord();
+    }
+
+    // 記録の解放
+    if (iocs->recordFile != NULL) {
+        playdate->file->close(iocs->recordFile);
+    }
+    if (iocs->recordBuffer != NULL) {
+        IocsRealloc(kIocsMemoryTagSystem, iocs->recordBuffer, 0);
+    }
+    IocsInitializeRecord();
+}
+
+// 入力の記録／再生中かどうかを判定する
+//
+bool IocsIsRecord(void)
+{
+    return iocs != NULL && iocs->recordMode == kIocsRecordWrite ? true : false;
+}
+bool IocsIsReplay(void)
+{
+    return iocs != NULL && iocs->recordMode == kIocsRecordRead ? true : false;
+}
+
+// 記録／再生したフレーム数を取得する
+//
+int IocsGetRecordFrame(void)
+{
+    return iocs != NULL ? iocs->recordFrame : 0;
+}
+
+// 記録を更新する
+//
+static void IocsUpdateRecord(void)
+{
+    if (iocs->recordMode == kIocsRecordWrite) {
+        IocsWriteRecord();
+    } else if (iocs->recordMode == kIocsRecordRead) {
+        IocsReadRecord();
+    }
+}
+
+// 1 フレームの入力を記録する
+//
+static void IocsWriteRecord(void)
+{
+    // 入力の量子化
+    PDButtons push = iocs->buttonPush & ((1 << kIocsButtonSize) - 1);
+    PDButtons edge = iocs->buttonEdge & ((1 << kIocsButtonSize) - 1);
+    int crank = IocsQuantizeCrank(iocs->crankAngle);
+
+    // 前のフレームとの差分
+    int flags = 0;
+    if (push != iocs->recordPush) {
+        flags |= kIocsRecordFlagPush;
+    }
+    if (edge != (push & ~iocs->recordPush)) {
+        flags |= kIocsRecordFlagEdge;
+    }
+    if (crank != iocs->recordCrank) {
+        flags |= kIocsRecordFlagCrank;
+    }
+
+    // 変化のないフレームは連続数だけを記録する
+    if (flags == 0) {
+        if (++iocs->recordRun >= kIocsRecordRunMaximum) {
+            IocsPutRecord(kIocsRecordFlagRun | (iocs->recordRun - 1), 1);
+            iocs->recordRun = 0;
+        }
+
+    // 変化した値だけを記録する
+    } else {
+        if (iocs->recordRun > 0) {
+            IocsPutRecord(kIocsRecordFlagRun | (iocs->recordRun - 1), 1);
+            iocs->recordRun = 0;
+        }
+        IocsPutRecord(flags, 1);
+        if ((flags & kIocsRecordFlagPush) != 0) {
+            IocsPutRecord(push, 1);
+        }
+        if ((flags & kIocsRecordFlagEdge) != 0) {
+            IocsPutRecord(edge, 1);
+        }
+        if ((flags & kIocsRecordFlagCrank) != 0) {
+            IocsPutRecord(crank, 2);
+        }
+    }
+
+    // 再生と同じ値で更新する
+    IocsSynthesizeButtonEvents(iocs->recordPush, push, edge);
+    iocs->buttonPush = push;
+    iocs->buttonEdge = edge;
+    iocs->recordPush = push;
+    IocsSetRecordCrank(crank);
+}
+
+// 1 フレームの入力を再生する
+//
+static void IocsReadRecord(void)
+{
+    // 前のフレームの値
+    PDButtons push = iocs->recordPush;
+    int crank = iocs->recordCrank;
+    int flags = 0;
+
+    // 変化のないフレームの連続
+    if (iocs->recordRun > 0) {
+        --iocs->recordRun;
+
+    // 記録の終端
+    } else if (iocs->recordPosition >= iocs->recordSize) {
+        IocsStopRecord();
+        return;
+
+    // 差分の読み込み
+    } else {
+        flags = (int)IocsGetRecord(1);
+        if ((flags & kIocsRecordFlagRun) != 0) {
+            iocs->recordRun = flags & ~kIocsRecordFlagRun;
+            flags = 0;
+        }
+    }
+    if ((flags & kIocsRecordFlagPush) != 0) {
+        push = (PDButtons)IocsGetRecord(1);
+    }
+    PDButtons edge = push & ~iocs->recordPush;
+    if ((flags & kIocsRecordFlagEdge) != 0) {
+        edge = (PDButtons)IocsGetRecord(1);
+    }
+    if ((flags & kIocsRecordFlagCrank) != 0) {
+        crank = (int)IocsGetRecord(2);
+    }
+
+    // 入力の置き換え
+    IocsSynthesizeButtonEvents(iocs->recordPush, push, edge);
+    iocs->buttonPush = push;
+    iocs->buttonEdge = edge;
+    iocs->recordPush = push;
+    IocsSetRecordCrank(crank);
+}
+
+// 記録に値を書き込む
+//
+static void IocsPutRecord(uint32_t value, int size)
+{
+    if (iocs->recordSize + size > kIocsRecordBufferSize) {
+        IocsFlushRecord();
+    }
+    for (int i = 0; i < size; i++) {
+        iocs->recordBuffer[iocs->recordSize++] = (unsigned char)(value >> (i * 8));
+    }
+}
+
+// 記録から値を読み込む
+//
+static uint32_t IocsGetRecord(int size)
 {
     uint32_t value = 0;
-    if (xorshift == NULL) {
-        xorshift = &iocs->xorshift;
+    for (int i = 0; i < size && iocs->recordPosition < iocs->recordSize; i++) {
+        value |= (uint32_t)iocs->recordBuffer[iocs->recordPosition++] << (i * 8);
+    }
+    return value;
+}
+
+// 記録をファイルに書き出す
+//
+static void IocsFlushRecord(void)
+{
+    // Playdate の取得
+    PlaydateAPI *playdate = IocsGetPlaydate();
+    if (playdate == NULL) {
+        return;
+    }
+
+    // バッファの書き出し
+    if (iocs->recordSize > 0) {
+        if (playdate->file->write(iocs->recordFile, iocs->recordBuffer, iocs->recordSize) != iocs->recordSize) {
+            playdate->system->logToConsole("%s: %d: record file is not written.", __FILE__, __LINE__);
+        }
+        iocs->recordSize = 0;
+    }
+}
+
+// クランクの角度を量子化する
+//
+static int IocsQuantizeCrank(float angle)
+{
+    int crank = (int)(angle * kIocsRecordCrankScale + 0.5f);
+    if (crank < 0 || crank >= 360 * kIocsRecordCrankScale) {
+        crank = 0;
     }
-    value = xorshift->seed;
-    value = value ^ (value << 13);
-    value = value ^ (value >> 17);
-    value = value ^ (value << 5);
-    xorshift->seed = value;
-    return (int)(value & 0x7fffffff);
+    return crank;
 }
-bool IocsGetRandomBool(struct XorShift *xorshift)
+
+// 量子化したクランクの角度を設定する
+//
+static void IocsSetRecordCrank(int crank)
 {
-    return (IocsGetRandomNumber(xorshift) & 0x10) != 0 ? true : false;
+    int change = crank - iocs->recordCrank;
+    if (change >= 180 * kIocsRecordCrankScale) {
+        change -= 360 * kIocsRecordCrankScale;
+    } else if (change < -180 * kIocsRecordCrankScale) {
+        change += 360 * kIocsRecordCrankScale;
+    }
+    iocs->crankAngle = (float)crank / kIocsRecordCrankScale;
+    iocs->crankChange = (float)change / kIocsRecordCrankScale;
+    iocs->recordCrank = crank;
 }
@@ -13,6 +13,61 @@
 enum {
     kIocsFrameRate = 30, 
     kIocsFrameMillisecond = 1000 / kIocsFrameRate, 
+    kIocsFrameMicrosecond = 1000000 / kIocsFrameRate, 
+    kIocsFrameSnapMicrosecond = 2000, 
+    kIocsFrameStepMaximum = 3, 
+};
+
+// メモリ
+//
+typedef enum {
+    kIocsMemoryTagSystem = 0, 
+    kIocsMemoryTagApplication, 
+    kIocsMemoryTagScene, 
+    kIocsMemoryTagActor, 
+    kIocsMemoryTagAseprite, 
+    kIocsMemoryTagField, 
+    kIocsMemoryTagMaze, 
+    kIocsMemoryTagPath, 
+    kIocsMemoryTagNav, 
+    kIocsMemoryTagPlayer, 
+    kIocsMemoryTagEnemy, 
+    kIocsMemoryTagHit, 
+    kIocsMemoryTagSnapshot, 
+    kIocsMemoryTagSize, 
+} IocsMemoryTag;
+struct IocsMemoryHeader {
+
+    // 確保したサイズ
+    uint32_t size;
+
+    // タグ
+    uint32_t tag;
+
+};
+struct IocsMemory {
+
+    // 使用中のバイト数とブロック数
+    int liveBytes[kIocsMemoryTagSize];
+    int liveCounts[kIocsMemoryTagSize];
+    int liveByte;
+
+    // 最大のバイト数
+    int peakBytes[kIocsMemoryTagSize];
+    int peakByte;
+
+    // このフレームで確保した回数
+    int frameCounts[kIocsMemoryTagSize];
+    int frameCount;
+
+    // リークの検出のための記録
+    int markBytes[kIocsMemoryTagSize];
+    int markCounts[kIocsMemoryTagSize];
+
+    // 次の記録に持ち越す確保の開始時の使用量
+    int carryBytes[kIocsMemoryTagSize];
+    int carryCounts[kIocsMemoryTagSize];
+
 };
 
 // フォント
@@ -24,6 +79,94 @@ typedef enum {
     kIocsFontSize, 
 } IocsFont;
 
+// テキストのキャッシュ
+//
+enum {
+    kIocsTextCacheSize = 32, 
+    kIocsTextCacheNull = -1, 
+    kIocsTextCacheTextSize = 32, 
+    kIocsTextCacheByte = 32 * 1024, 
+};
+struct IocsTextCache {
+
+    // キー
+    IocsFont font;
+    uint32_t hash;
+    char text[kIocsTextCacheTextSize];
+
+    // 幅と高さ
+    int width;
+    int height;
+
+    // 描画済みのビットマップ
+    LCDBitmap *bitmap;
+    int byte;
+
+    // 最後に使われた順番
+    uint32_t use;
+
+};
+
+// 描画コマンド
+//
+typedef enum {
+    kIocsDrawBitmap = 0, 
+    kIocsDrawRotatedBitmap, 
+    kIocsDrawRect, 
+    kIocsDrawFillRect, 
+} IocsDrawType;
+enum {
+    kIocsDrawCommandSize = 512, 
+    kIocsDrawOrderSize = 512, 
+    kIocsDrawClipSize = 16, 
+    kIocsDrawClipNull = 0, 
+    kIocsDrawKeyOrderShift = 23, 
+    kIocsDrawKeyClipShift = 19, 
+    kIocsDrawKeyModeShift = 16, 
+    kIocsDrawKeyIndexMask = 0xffff, 
+};
+struct IocsDrawCommand {
+
+    // 種類
+    unsigned char type;
+
+    // 描画モードと反転
+    unsigned char mode;
+    unsigned char flip;
+
+    // クリップ
+    unsigned char clip;
+
+    // 位置と大きさ
+    short x;
+    short y;
+    short width;
+    short height;
+
+    // ビットマップ
+    LCDBitmap *bitmap;
+
+    // 色
+    LCDColor color;
+
+    // 回転と拡大
+    float degrees;
+    float centerX;
+    float centerY;
+    float scaleX;
+    float scaleY;
+
+};
+struct IocsDrawClip {
+
+    // 位置と大きさ
+    short x;
+    short y;
+    short width;
+    short height;
+
+};
+
 // ボタン
 //
 typedef enum {
@@ -36,6 +179,25 @@ typedef enum {
     kIocsButtonSize, 
 } IocsButton;
 
+// ボタンのイベント
+//
+enum {
+    kIocsButtonEventSize = 32, 
+    kIocsButtonEventMask = kIocsButtonEventSize - 1, 
+};
+struct IocsButtonEvent {
+
+    // ボタン
+    PDButtons button;
+
+    // 押された／離された
+    bool down;
+
+    // 時刻（ミリ秒）
+    uint32_t when;
+
+};
+
 // オーディオ
 //
 typedef enum {
@@ -46,14 +208,64 @@ typedef enum {
     kIocsAudioSystemSampleSize, 
 } IocsAudioSystemSample;
 enum {
-    kIocsAudioEffectSampleSize = 16, 
+    kIocsAudioEffectSampleSize = 64, 
+    kIocsAudioEffectSampleNull = -1, 
+    kIocsAudioEffectPathSize = 32, 
+    kIocsAudioEffectKeepFrame = 30, 
     kIocsAudioEffectPlayerSize = 8, 
+    kIocsAudioEffectPlayerNull = -1, 
+    kIocsAudioEffectPlayerFree = (1 << kIocsAudioEffectPlayerSize) - 1, 
+    kIocsAudioEffectPriorityDefault = 0, 
+};
+enum {
+    kIocsAudioBankSize = 8, 
+    kIocsAudioBankNull = -1, 
+    kIocsAudioBankNameSize = 16, 
+    kIocsAudioBankSampleSize = 16, 
+};
+struct IocsAudioBank {
+
+    // 名前
+    char name[kIocsAudioBankNameSize];
+
+    // 参照数
+    int reference;
+
+    // サンプル
+    int samples[kIocsAudioBankSampleSize];
+    int sampleSize;
+
+};
+
+// 記録
+//
+typedef enum {
+    kIocsRecordNull = 0, 
+    kIocsRecordWrite, 
+    kIocsRecordRead, 
+} IocsRecord;
+enum {
+    kIocsRecordMagic = 0x33505249, 
+    kIocsRecordHeaderSize = 4 + 1 + 2, 
+    kIocsRecordBufferSize = 256, 
+    kIocsRecordFlagPush = 0x01, 
+    kIocsRecordFlagEdge = 0x02, 
+    kIocsRecordFlagCrank = 0x04, 
+    kIocsRecordFlagRun = 0x80, 
+    kIocsRecordRunMaximum = 0x80, 
+    kIocsRecordCrankScale = 64, 
 };
 
-// 乱数
+// 乱数（カウンタ方式のストリーム）
 //
-struct XorShift {
-    uint32_t seed;
+struct IocsRandom {
+
+    // ストリームごとの鍵
+    uint64_t key;
+
+    // 次に取り出す値の番号
+    uint64_t counter;
+
 };
 
 // 入出力聖書システム
@@ -63,12 +275,42 @@ struct Iocs {
     // Playdate
     PlaydateAPI *playdate;
 
+    // メモリ
+    struct IocsMemory memory;
+
+    // フレーム
+    int frameAccumulator;
+    int frameStep;
+    int frameStepBegin;
+    float frameAlpha;
+
     // フォント
     LCDFont *fonts[kIocsFontSize];
 
+    // テキストのキャッシュ
+    struct IocsTextCache textCaches[kIocsTextCacheSize];
+    int textCacheSize;
+    int textCacheByte;
+    uint32_t textCacheUse;
+
     // 画面
     LCDColor screenColor;
 
+    // 描画コマンド
+    struct IocsDrawCommand drawCommands[kIocsDrawCommandSize];
+    uint32_t drawKeys[kIocsDrawCommandSize];
+    int drawCommandSize;
+    struct IocsDrawClip drawClips[kIocsDrawClipSize];
+    int drawClipSize;
+    int drawClip;
+    int drawOrder;
+
+    // 描画の統計
+    int drawCount;
+    int drawCullCount;
+    int drawModeCount;
+    int drawClipCount;
+
     // ボタン
     PDButtons buttonPush;
     PDButtons buttonEdge;
@@ -76,6 +318,12 @@ struct Iocs {
     int buttonRepeatCounts[kIocsButtonSize];
     int buttonRepeatCountDelay;
     int buttonRepeatCountInterval;
+    struct IocsButtonEvent buttonEventRing[kIocsButtonEventSize];
+    volatile uint32_t buttonEventHead;
+    volatile uint32_t buttonEventTail;
+    uint32_t buttonEventLost;
+    struct IocsButtonEvent buttonEvents[kIocsButtonEventSize];
+    int buttonEventSize;
 
     // クランク
     float crankAngle;
@@ -86,12 +334,35 @@ struct Iocs {
     int audioSystemFrames[kIocsAudioSystemSampleSize];
     SamplePlayer *audioSystemPlayer;
     AudioSample *audioEffectSamples[kIocsAudioEffectSampleSize];
+    char audioEffectPaths[kIocsAudioEffectSampleSize][kIocsAudioEffectPathSize];
+    int audioEffectReferences[kIocsAudioEffectSampleSize];
+    int audioEffectIdles[kIocsAudioEffectSampleSize];
+    int audioEffectBytes[kIocsAudioEffectSampleSize];
     int audioEffectFrames[kIocsAudioEffectSampleSize];
+    int audioEffectPriorities[kIocsAudioEffectSampleSize];
+    int audioEffectLimits[kIocsAudioEffectSampleSize];
     SamplePlayer *audioEffectPlayers[kIocsAudioEffectPlayerSize];
+    int audioEffectPlayerSamples[kIocsAudioEffectPlayerSize];
+    uint32_t audioEffectPlayerStarts[kIocsAudioEffectPlayerSize];
+    volatile uint32_t audioEffectPlayerFinishes[kIocsAudioEffectPlayerSize];
+    uint32_t audioEffectPlayerStart;
+    uint32_t audioEffectPlayerFree;
     FilePlayer *audioMusicPlayer;
+    struct IocsAudioBank audioBanks[kIocsAudioBankSize];
 
     // 乱数
-    struct XorShift xorshift;
+    struct IocsRandom random;
+
+    // 記録
+    IocsRecord recordMode;
+    SDFile *recordFile;
+    unsigned char *recordBuffer;
+    int recordSize;
+    int recordPosition;
+    int recordRun;
+    int recordFrame;
+    PDButtons recordPush;
+    int recordCrank;
 
 };
 
@@ -104,22 +375,55 @@ extern PlaydateAPI *IocsGetPlaydate(void);
 extern void IocsEventHandler(PDSystemEvent event, uint32_t arg);
 extern void IocsUpdateBegin(void);
 extern void IocsUpdateEnd(void);
+extern void IocsDraw(void);
+extern int IocsUpdateFrame(void);
+extern void *IocsRealloc(IocsMemoryTag tag, void *pointer, size_t size);
+extern const struct IocsMemory *IocsGetMemory(void);
+extern void IocsMarkMemory(void);
+extern void IocsCarryMemoryBegin(void);
+extern void IocsCarryMemoryEnd(void);
+extern void IocsReportMemory(void);
 extern int IocsGetFrameRate(void);
 extern int IocsGetFrameMillisecond(void);
+extern int IocsGetFrameStep(void);
+extern int IocsGetFrameIdle(void);
+extern float IocsGetFrameAlpha(void);
 extern void IocsSetFont(IocsFont font);
 extern int IocsGetFontHeight(IocsFont font);
 extern int IocsGetTextWidth(IocsFont font, const char *text);
+extern void IocsDrawText(IocsFont font, const char *text, int x, int y, LCDBitmapDrawMode mode);
 extern void IocsSetScreenColor(LCDColor color);
 extern void IocsClearScreen(void);
+extern void IocsSetDrawOrder(int order);
+extern void IocsSetDrawClip(int x, int y, int width, int height);
+extern void IocsClearDrawClip(void);
+extern bool IocsIsDrawVisible(int left, int top, int right, int bottom);
+extern void IocsDrawBitmap(LCDBitmap *bitmap, int x, int y, int width, int height, LCDBitmapDrawMode mode, LCDBitmapFlip flip);
+extern void IocsDrawRotatedBitmap(LCDBitmap *bitmap, int x, int y, int width, int height, float degrees, float centerx, float centery, float xscale, float yscale, LCDBitmapDrawMode mode);
+extern void IocsDrawRect(int x, int y, int width, int height, LCDColor color);
+extern void IocsFillRect(int x, int y, int width, int height, LCDColor color);
+extern void IocsSubmitDraw(void);
 extern bool IocsIsButtonPush(PDButtons button);
 extern bool IocsIsButtonEdge(PDButtons button);
 extern bool IocsIsButtonRepeat(PDButtons button);
+extern const struct IocsButtonEvent *IocsFindButtonEvent(void);
+extern const struct IocsButtonEvent *IocsNextButtonEvent(const struct IocsButtonEvent *event);
 extern float IocsGetCrankAngle(void);
 extern float IocsGetCrankChange(void);
+extern bool IocsStartRecord(const char *path);
+extern bool IocsStartReplay(const char *path);
+extern void IocsStopRecord(void);
+extern bool IocsIsRecord(void);
+extern bool IocsIsReplay(void);
+extern int IocsGetRecordFrame(void);
 extern void IocsPlayAudioSystem(IocsAudioSystemSample sample, int repeat);
 extern void IocsStopAudioSystem(void);
-extern void IocsLoadAudioEffects(const char *paths[], int size);
-extern void IocsUnloadAllAudioEffects(void);
+extern int IocsRetainAudioBank(const char *name, const char *paths[], int size, bool preload);
+extern void IocsReleaseAudioBank(const char *name);
+extern bool IocsIsAudioBankLoaded(int bank);
+extern int IocsGetAudioBankSample(int bank, int index);
+extern int IocsGetAudioBankByte(int bank);
+extern void IocsSetAudioEffectPriority(int sample, int priority, int limit);
 extern int IocsPlayAudioEffect(int sample, int repeat);
 extern void IocsStopAudioEffect(int player);
 extern void IocsStopAllAudioEffects(void);
@@ -127,7 +431,11 @@ extern void IocsPlayMusicAudio(const char *path, int repeat);
 extern void IocsStopMusicAudio(void);
 extern int IocsGetCharByte(char c);
 extern int IocsGetTextLength(const char *text);
-extern void IocsSetRandomSeed(struct XorShift *xorshift, uint32_t seed);
-extern int IocsGetRandomNumber(struct XorShift *xorshift);
-extern bool IocsGetRandomBool(struct XorShift *xorshift);
+extern void IocsSetRandomSeed(struct IocsRandom *random, uint32_t seed);
+extern void IocsSetRandomStream(struct IocsRandom *random, uint32_t seed, const char *name);
+extern int IocsGetRandomNumber(struct IocsRandom *random);
+extern bool IocsGetRandomBool(struct IocsRandom *random);
+extern uint32_t IocsGetRandomNumberAt(const struct IocsRandom *random, uint64_t index);
+extern void IocsSkipRandom(struct IocsRandom *random, uint64_t count);
+extern void IocsFillRandom(struct IocsRandom *random, uint32_t *values, int size);
 
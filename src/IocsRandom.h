@@ -0,0 +1,42 @@
+// IocsRandom.h - 乱数の計算
+//
+// Iocs.c とホスト上のツールで同じ系列を得るために、状態を持たない計算だけをここに置く。
+//
+#pragma once
+
+// 外部参照
+//
+#include <stddef.h>
+#include <stdint.h>
+
+
+// 乱数の値をかき混ぜる（SplitMix64）
+//
+static inline uint64_t IocsMixRandom(uint64_t value)
+{
+    value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ull;
+    value = (value ^ (value >> 27)) * 0x94d049bb133111ebull;
+    return value ^ (value >> 31);
+}
+
+// 種と名前からストリームの鍵を作る（名前は NULL でもよい）
+//
+static inline uint64_t IocsMakeRandomKey(uint32_t seed, const char *name)
+{
+    uint64_t key = seed;
+    if (name != NULL) {
+        uint64_t hash = 14695981039346656037ull;
+        while (*name != '\0') {
+            hash = (hash ^ (unsigned char)*name++) * 1099511628211ull;
+        }
+        key ^= hash;
+    }
+    return IocsMixRandom(key);
+}
+
+// 鍵と番号から乱数を作る
+//
+static inline uint32_t IocsMixRandomAt(uint64_t key, uint64_t index)
+{
+    return (uint32_t)(IocsMixRandom(key + (index + 1) * 0x9e3779b97f4a7c15ull) >> 32);
+}
@@ -6,10 +6,13 @@
 #include <string.h>
 #include "pd_api.h"
 #include "Iocs.h"
+#include "Aseprite.h"
 #include "Scene.h"
 
 // 内部関数
 //
+static void SceneReleaseArena(struct SceneArenaBlock *block);
+static void SceneCancelPrefetch(void);
 
 // 内部変数
 //
@@ -27,7 +30,7 @@ void SceneInitialize(void)
     }
 
     // シーンコントローラの作成
-    sceneController = playdate->system->realloc(NULL, sizeof (struct SceneController));
+    sceneController = IocsRealloc(kIocsMemoryTagScene, NULL, sizeof (struct SceneController));
     if (sceneController == NULL) {
         playdate->system->error("%s: %d: scene controller instance is not created.", __FILE__, __LINE__);
         return;
@@ -67,12 +70,25 @@ void SceneUpdateEnd(void)
             (*sceneController->unload)(sceneController->userdata);
             sceneController->unload = NULL;
         }
-        if (sceneController->userdata != NULL) {
-            playdate->system->realloc(sceneController->userdata, 0);
-            sceneController->userdata = NULL;
+        sceneController->userdata = NULL;
+        SceneReleaseArena(sceneController->arenaBlocks);
+        sceneController->arenaBlocks = NULL;
+
+        // 先読みしたシーンならアリーナを引き継ぎ、そうでなければ先読みを取り消す
+        if (sceneController->prefetchScene == sceneController->transition) {
+            sceneController->arenaBlocks = sceneController->prefetchBlocks;
+            sceneController->prefetchBlocks = NULL;
+            sceneController->prefetchScene = NULL;
+            sceneController->prefetchManifest = NULL;
+        } else {
+            SceneCancelPrefetch();
+        }
+        if (sceneController->update != NULL) {
+            IocsReportMemory();
         }
         sceneController->update = sceneController->transition;
         sceneController->transition = NULL;
+        IocsMarkMemory();
     }
 }
 
@@ -104,3 +120,146 @@ void *SceneGetUserdata(void)
    return  sceneController->userdata;
 }
 
+// シーンのアリーナからメモリを確保する
+//
+// 確保したメモリは個別に解放せず、シーンの遷移でまとめて解放される
+//
+void *SceneAllocate(size_t size)
+{
+    // Playdate の取得
+    PlaydateAPI *playdate = IocsGetPlaydate();
+    if (playdate == NULL) {
+        return NULL;
+    }
+
+    // 空きのあるブロックを探す（先読み中は次のシーンのアリーナから確保する）
+    size = (size + kSceneArenaAlign - 1) & ~(size_t)(kSceneArenaAlign - 1);
+    struct SceneArenaBlock **last = sceneController->arenaPrefetch ? &sceneController->prefetchBlocks : &sceneController->arenaBlocks;
+    struct SceneArenaBlock *block = *last;
+    while (block != NULL && block->size - block->used < size) {
+        last = &block->next;
+        block = block->next;
+    }
+
+    // ブロックの作成
+    if (block == NULL) {
+        size_t header = (sizeof (struct SceneArenaBlock) + kSceneArenaAlign - 1) & ~(size_t)(kSceneArenaAlign - 1);
+        size_t blockSize = size > kSceneArenaBlockSize ? size : kSceneArenaBlockSize;
+        block = (struct SceneArenaBlock *)IocsRealloc(kIocsMemoryTagScene, NULL, header + blockSize);
+        if (block == NULL) {
+            playdate->system->logToConsole("%s: %d: scene arena block is not created: %d bytes.", __FILE__, __LINE__, (int)blockSize);
+            return NULL;
+        }
+        block->next = NULL;
+        block->base = (unsigned char *)block + header;
+        block->size = blockSize;
+        block->used = 0;
+        *last = block;
+    }
+
+    // 領域の確保
+    void *result = block->base + block->used;
+    block->used += size;
+    return result;
+}
+
+// シーンのアリーナを解放する
+//
+static void SceneReleaseArena(struct SceneArenaBlock *block)
+{
+    while (block != NULL) {
+        struct SceneArenaBlock *next = block->next;
+        IocsRealloc(kIocsMemoryTagScene, block, 0);
+        block = next;
+    }
+}
+
+// 次のシーンの先読みを開始する
+//
+void ScenePrefetch(SceneFunction scene, const struct SceneManifest *manifest)
+{
+    // 先読み中のシーンの確認
+    if (sceneController->prefetchScene == scene) {
+        return;
+    }
+    SceneCancelPrefetch();
+
+    // 先読みの設定
+    sceneController->prefetchScene = scene;
+    sceneController->prefetchManifest = manifest;
+    sceneController->prefetchSprite = 0;
+    sceneController->prefetchSpriteLoads = 0;
+    sceneController->prefetchDone = manifest == NULL ? true : false;
+}
+
+// フレームの空き時間で次のシーンを先読みする
+//
+void SceneUpdatePrefetch(int millisecond)
+{
+    // 先読みの確認
+    if (sceneController->prefetchScene == NULL || sceneController->prefetchDone) {
+        return;
+    }
+
+    // 描画の転送のための余裕を残す
+    millisecond -= kScenePrefetchMarginMillisecond;
+    if (millisecond < kScenePrefetchMinimumMillisecond) {
+        return;
+    }
+
+    // 次のシーンのアリーナに切り替える
+    const struct SceneManifest *manifest = sceneController->prefetchManifest;
+    IocsCarryMemoryBegin();
+    sceneController->arenaPrefetch = true;
+
+    // スプライトは 1 フレームに 1 つずつ読み込む（今のシーンが読み込んでいるものは取り消しで解放しない）
+    if (sceneController->prefetchSprite < manifest->spriteSize) {
+        const char *name = manifest->spriteNames[sceneController->prefetchSprite];
+        if (!AsepriteIsSpriteLoaded(name) && sceneController->prefetchSprite < kScenePrefetchSpriteSize) {
+            AsepriteLoadSprite(name);
+            sceneController->prefetchSpriteLoads |= (uint32_t)1 << sceneController->prefetchSprite;
+        }
+        ++sceneController->prefetchSprite;
+
+    // 生成を進める
+    } else if (manifest->prefetch == NULL || (*manifest->prefetch)(millisecond)) {
+        sceneController->prefetchDone = true;
+    }
+
+    // 今のシーンのアリーナに戻す
+    sceneController->arenaPrefetch = false;
+    IocsCarryMemoryEnd();
+}
+
+// 先読みが完了したかどうかを判定する
+//
+bool SceneIsPrefetchDone(void)
+{
+    return sceneController->prefetchScene != NULL && sceneController->prefetchDone;
+}
+
+// 先読みを取り消す
+//
+static void SceneCancelPrefetch(void)
+{
+    if (sceneController->prefetchScene != NULL) {
+        IocsCarryMemoryBegin();
+        const struct SceneManifest *manifest = sceneController->prefetchManifest;
+        if (manifest != NULL) {
+            for (int i = 0; i < manifest->spriteSize && i < kScenePrefetchSpriteSize; i++) {
+                if ((sceneController->prefetchSpriteLoads & ((uint32_t)1 << i)) != 0) {
+                    AsepriteUnloadSprite(manifest->spriteNames[i]);
+                }
+            }
+            if (manifest->unload != NULL) {
+                (*manifest->unload)();
+            }
+        }
+        SceneReleaseArena(sceneController->prefetchBlocks);
+        IocsCarryMemoryEnd();
+        sceneController->prefetchBlocks = NULL;
+        sceneController->prefetchScene = NULL;
+        sceneController->prefetchManifest = NULL;
+        sceneController->prefetchSpriteLoads = 0;
+    }
+}
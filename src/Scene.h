@@ -12,6 +12,48 @@
 //
 typedef void (*SceneFunction)(void *);
 
+// アリーナ
+//
+enum {
+    kSceneArenaBlockSize = 64 * 1024, 
+    kSceneArenaAlign = 8, 
+};
+struct SceneArenaBlock {
+
+    // 次のブロック
+    struct SceneArenaBlock *next;
+
+    // 領域
+    unsigned char *base;
+    size_t size;
+    size_t used;
+
+};
+
+// 先読み
+//
+typedef bool (*ScenePrefetchFunction)(int millisecond);
+typedef void (*ScenePrefetchUnloadFunction)(void);
+enum {
+    kScenePrefetchMarginMillisecond = 4, 
+    kScenePrefetchMinimumMillisecond = 2, 
+    kScenePrefetchSpriteSize = 32, 
+};
+struct SceneManifest {
+
+    // スプライト
+    const char **spriteNames;
+    int spriteSize;
+
+    // 生成（少しずつ進めて、完了したら true を返す）
+    ScenePrefetchFunction prefetch;
+
+    // 先読みで作成したものだけの解放（先読みしたシーンに遷移しなかったときに呼ばれる）
+    ScenePrefetchUnloadFunction unload;
+
+};
+typedef const struct SceneManifest *(*SceneManifestFunction)(void);
+
 // シーンコントローラ
 //
 struct SceneController {
@@ -28,6 +70,18 @@ struct SceneController {
     // ユーザデータ
     void *userdata;
 
+    // アリーナ
+    struct SceneArenaBlock *arenaBlocks;
+    bool arenaPrefetch;
+
+    // 先読み
+    SceneFunction prefetchScene;
+    const struct SceneManifest *prefetchManifest;
+    int prefetchSprite;
+    uint32_t prefetchSpriteLoads;
+    bool prefetchDone;
+    struct SceneArenaBlock *prefetchBlocks;
+
 };
 
 
@@ -40,4 +94,8 @@ extern void SceneTransition(SceneFunction transition);
 extern void SceneSetUnload(SceneFunction unload);
 extern void SceneSetUserdata(void *userdata);
 extern void *SceneGetUserdata(void);
+extern void *SceneAllocate(size_t size);
+extern void ScenePrefetch(SceneFunction scene, const struct SceneManifest *manifest);
+extern void SceneUpdatePrefetch(int millisecond);
+extern bool SceneIsPrefetchDone(void);
 
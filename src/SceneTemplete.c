@@ -40,7 +40,7 @@ void TempleteUpdate(struct Templete *templete)
     if (templete == NULL) {
 
         // テンプレートの作成
-        templete = playdate->system->realloc(NULL, sizeof (struct Templete));
+        templete = SceneAllocate(sizeof (struct Templete));
         if (templete == NULL) {
             playdate->system->error("%s: %d: templete instance is not created.", __FILE__, __LINE__);
             return;
@@ -76,8 +76,10 @@ static void TempleteUnload(struct Templete *templete)
     // アクタの解放
     ActorUnloadAll();
 
-    // スプライトの解放
-    AsepriteUnloadAllSprites();
+    // スプライトの解放（先読みした次のシーンのスプライトは残す）
+    for (int i = 0; i < kTempleteSpriteNameSize; i++) {
+        AsepriteUnloadSprite(templeteSpriteNames[i]);
+    }
 }
 
 // 処理を遷移する
@@ -6,6 +6,7 @@
 #include <string.h>
 #include "pd_api.h"
 #include "Iocs.h"
+#include "Scene.h"
 #include "Actor.h"
 #include "Game.h"
 #include "Field.h"
@@ -17,6 +18,8 @@
 // 内部変数
 //
 struct Enemy *enemy = NULL;
+static const char *enemyBehaviourPath = "jsons/enemy-behaviours.json";
+static const char *enemyRandomName = "enemy";
 
 
 // エネミーを初期化する
@@ -35,22 +38,41 @@ void EnemyInitialize(void)
     }
 
     // エネミーの作成
-    enemy = (struct Enemy *)playdate->system->realloc(NULL, sizeof (struct Enemy));
+    enemy = (struct Enemy *)SceneAllocate(sizeof (struct Enemy));
     if (enemy == NULL) {
         playdate->system->error("%s: %d: enemy instance is not created.", __FILE__, __LINE__);
     }
 
     // エネミーの初期化
     {
+        // 振る舞いの読み込み
+        EnemyLoadBehaviours(enemyBehaviourPath);
+
+        // 乱数の初期化
+        IocsSetRandomStream(&enemy->random, kFieldRandomSeed, enemyRandomName);
+
+        // セルの初期化
+        for (int i = 0; i < kEnemyCellSizeY; i++) {
+            for (int j = 0; j < kEnemyCellSizeX; j++) {
+                enemy->cellHeads[i][j] = kEnemyCellNull;
+            }
+        }
+
         // エネミー配置
         {
             for (int i = 0; i < kEnemyPoolSize; i++) {
                 const struct EnemyPool *pool = &enemyPools[0];
                 const struct EnemyData *data = &enemyDatas[pool->type];
                 enemy->pools[i].type = pool->type;
+                enemy->pools[i].life = data->life;
                 FieldGetEnemyPosition(&enemy->pools[i].position, true);
+                EnemySleepPool(i);
             }
         }
+
+        // バッチの初期化
+        enemy->batch.size = 0;
+        enemy->batch.frame = 0;
     }
 }
 
@@ -64,9 +86,26 @@ void EnemyRelease(void)
         return;
     }
 
-    // エネミーの解放
-    if (enemy != NULL) {
-        playdate->system->realloc(enemy, 0);
-        enemy = NULL;
+    // エネミーの解放（メモリはシーンのアリーナと一緒に解放される）
+    enemy = NULL;
+}
+
+// プールを休眠させて位置のセルにつなぐ
+//
+void EnemySleepPool(int index)
+{
+    struct EnemyPool *pool = &enemy->pools[index];
+    int x = pool->position.x % (kFieldSizeX * kFieldSizePixel);
+    if (x < 0) {
+        x += kFieldSizeX * kFieldSizePixel;
+    }
+    int y = pool->position.y;
+    if (y < 0) {
+        y = 0;
+    } else if (y >= kFieldSizeY * kFieldSizePixel) {
+        y = kFieldSizeY * kFieldSizePixel - 1;
     }
+    int *head = &enemy->cellHeads[y / kEnemyCellPixelY][x / kEnemyCellPixelX];
+    pool->next = *head;
+    *head = index;
 }
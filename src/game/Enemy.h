@@ -9,6 +9,7 @@
 #include "Actor.h"
 #include "Aseprite.h"
 #include "Define.h"
+#include "Field.h"
 
 
 // 種類
@@ -25,12 +26,68 @@ enum {
     kEnemyLifeNull = 0, 
 };
 
-// アクション
+// 振る舞い
 //
 enum {
-    kEnemyActionNull = 0, 
-    kEnemyActionIdle, 
-    kEnemyActionSize, 
+    kEnemyBehaviourNull = -1, 
+    kEnemyBehaviourSize = 16, 
+    kEnemyBehaviourNameSize = 16, 
+};
+struct EnemyBehaviour {
+
+    // 名前
+    char name[kEnemyBehaviourNameSize];
+
+    // 命令の範囲
+    int code;
+    int codeSize;
+
+};
+
+// 命令
+//
+enum {
+    kEnemyCodeWait = 0, 
+    kEnemyCodeMove, 
+    kEnemyCodeFace, 
+    kEnemyCodeJump, 
+    kEnemyCodeIf, 
+    kEnemyCodeGoto, 
+    kEnemyCodeChase, 
+    kEnemyCodeOpSize, 
+};
+enum {
+    kEnemyCodeFacePlayer = 0, 
+    kEnemyCodeFaceRandom, 
+    kEnemyCodeFaceBack, 
+    kEnemyCodeFaceSize, 
+};
+enum {
+    kEnemyCodeIfWall = 0, 
+    kEnemyCodeIfLedge, 
+    kEnemyCodeIfNear, 
+    kEnemyCodeIfGround, 
+    kEnemyCodeIfRandom, 
+    kEnemyCodeIfSize, 
+};
+enum {
+    kEnemyCodeSize = 256, 
+    kEnemyCodeStepMaximum = 16, 
+    kEnemyCodeTimerNull = -1, 
+    kEnemyCodeNear = 96, 
+    kEnemyCodeChaseJump = 0x0600, 
+};
+struct EnemyCode {
+
+    // 命令
+    unsigned char op;
+
+    // 種類（向き、条件）
+    unsigned char kind;
+
+    // 引数（フレーム数、速度、飛び先）
+    short arg;
+
 };
 
 // 速度
@@ -42,6 +99,18 @@ enum {
     kEnemySpeedOne = 0x0100, 
     kEnemySpeedShift = 8, 
     kEnemySpeedMask = 0xff, 
+    kEnemySpeedGravity = 0x0100, 
+    kEnemySpeedFallMaximum = 0x0800, 
+};
+
+// 詳細度
+//
+enum {
+    kEnemyLodScreen = 0, 
+    kEnemyLodNear, 
+    kEnemyLodFar, 
+    kEnemyLodSize, 
+    kEnemyLodNearMargin = 48, 
 };
 
 // データ
@@ -57,8 +126,8 @@ struct EnemyData {
     // 体力
     int life;
 
-    // 行動
-    int action;
+    // 振る舞いの名前
+    const char *behaviour;
 
     // 速度
     int speed;
@@ -72,6 +141,9 @@ struct EnemyData {
     // 中心
     float centerX;
     float centerY;
+
+    // 詳細度ごとの更新間隔（2 の累乗のフレーム数）
+    int lodIntervals[kEnemyLodSize];
  
 };
 
@@ -85,76 +157,146 @@ struct EnemyPool {
     // 種類
     int type;
 
+    // 体力
+    int life;
+
     // 位置
     struct Vector position;
 
-};
-
-// エネミー
-//
-struct Enemy {
-
-    // プール
-    struct EnemyPool pools[kEnemyPoolSize];
+    // 同じセルの次のプール
+    int next;
 
 };
 
-// 体の向き
+// セル
 //
 enum {
-    kEnemyFaceLeft = 0, 
-    kEnemyFaceRight, 
-    kEnemyFaceSize, 
+    kEnemyCellNull = -1, 
+    kEnemyCellSizeX = kFieldMazeSizeX, 
+    kEnemyCellSizeY = kFieldMazeSizeY, 
+    kEnemyCellPixelX = kFieldSectionSizeX * kFieldSizePixel, 
+    kEnemyCellPixelY = kFieldSectionSizeY * kFieldSizePixel, 
 };
 
-// 移動
+// 出現
 //
 enum {
-    kEnemyMoveParamSize = 8, 
+    kEnemyStreamSpawn = 48, 
+    kEnemyStreamDespawn = 96, 
 };
 
-// 点滅
+// バッチ
 //
 enum {
-    kEnemyBlinkDamage = 30, 
-    kEnemyBlinkInterval = 0x02, 
+    kEnemyBatchSize = 48, 
 };
+struct EnemyBatch {
 
-// エネミーアクタ
-//
-struct EnemyActor {
-
-    // アクタ
-    struct Actor actor;
+    // 数
+    int size;
 
-    // インデックス
-    int index;
+    // プールのインデックス
+    int indices[kEnemyBatchSize];
 
     // データ
-    const struct EnemyData *data;
+    const struct EnemyData *datas[kEnemyBatchSize];
+
+    // 振る舞い
+    int behaviours[kEnemyBatchSize];
+    int states[kEnemyBatchSize];
+    int pcs[kEnemyBatchSize];
+    int timers[kEnemyBatchSize];
 
     // 体力
-    int life;
+    int lifes[kEnemyBatchSize];
 
     // 位置
-    struct Vector position;
+    int positionXs[kEnemyBatchSize];
+    int positionYs[kEnemyBatchSize];
 
     // 向き
-    int direction;
+    int directions[kEnemyBatchSize];
 
     // 体の向き
-    int face;
+    int faces[kEnemyBatchSize];
 
     // 移動
-    int moveSpeed;
-    int moveParams[kEnemyMoveParamSize];
-    struct Rect moveRect;
+    int moveSpeeds[kEnemyBatchSize];
+    int moveFractionXs[kEnemyBatchSize];
+    int moveFractionYs[kEnemyBatchSize];
+    int moveVectorYs[kEnemyBatchSize];
+    int moveLefts[kEnemyBatchSize];
+    int moveTops[kEnemyBatchSize];
+    int moveRights[kEnemyBatchSize];
+    int moveBottoms[kEnemyBatchSize];
 
     // 点滅
-    int blink;
+    int blinks[kEnemyBatchSize];
 
     // アニメーション
-    struct AsepriteSpriteAnimation animation;
+    struct AsepriteSpriteAnimation animations[kEnemyBatchSize];
+
+    // 詳細度
+    int lods[kEnemyBatchSize];
+
+    // 前回の更新からのフレーム数
+    int steps[kEnemyBatchSize];
+
+    // フレーム
+    int frame;
+
+    // 振る舞いごとの一覧
+    int behaviourIndices[kEnemyBatchSize];
+
+};
+
+// エネミー
+//
+struct Enemy {
+
+    // プール
+    struct EnemyPool pools[kEnemyPoolSize];
+
+    // 振る舞い
+    struct EnemyBehaviour behaviours[kEnemyBehaviourSize];
+    int behaviourSize;
+
+    // 命令
+    struct EnemyCode codes[kEnemyCodeSize];
+    int codeSize;
+
+    // セルごとの休眠中のプール
+    int cellHeads[kEnemyCellSizeY][kEnemyCellSizeX];
+
+    // バッチ
+    struct EnemyBatch batch;
+
+    // 乱数
+    struct IocsRandom random;
+
+};
+
+// 体の向き
+//
+enum {
+    kEnemyFaceLeft = 0, 
+    kEnemyFaceRight, 
+    kEnemyFaceSize, 
+};
+
+// 点滅
+//
+enum {
+    kEnemyBlinkDamage = 30, 
+    kEnemyBlinkInterval = 0x02, 
+};
+
+// エネミーアクタ（バッチの更新と描画をまとめて行う）
+//
+struct EnemyActor {
+
+    // アクタ
+    struct Actor actor;
 
 };
 
@@ -162,6 +304,9 @@ struct EnemyActor {
 //
 extern void EnemyInitialize(void);
 extern void EnemyRelease(void);
+extern void EnemySleepPool(int index);
+extern void EnemyLoadBehaviours(const char *path);
+extern int EnemyFindBehaviour(const char *name);
 extern void EnemyActorLoad(void);
 
 // 外部参照変数
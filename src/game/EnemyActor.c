@@ -9,26 +9,40 @@
 #include "Actor.h"
 #include "Game.h"
 #include "Field.h"
+#include "Nav.h"
+#include "Player.h"
 #include "Enemy.h"
+#include "Hit.h"
 
 // 内部関数
 //
 static void EnemyActorUnload(struct EnemyActor *actor);
 static void EnemyActorDraw(struct EnemyActor *actor);
-static void EnemyActorNull(struct EnemyActor *actor);
-static void EnemyActorIdle(struct EnemyActor *actor);
-static int EnemyActorGetWalkableDirection(struct EnemyActor *actor);
-static int EnemyActorGetWalkableRandomDirection(struct EnemyActor *actor);
-static bool EnemyActorMoveToDestination(struct EnemyActor *actor);
-static bool EnemyActorBlink(struct EnemyActor *actor);
-static void EnemyActorCalc(struct EnemyActor *actor);
+static void EnemyActorLoop(struct EnemyActor *actor);
+static void EnemyActorStream(struct EnemyBatch *batch);
+static void EnemyActorHit(struct EnemyBatch *batch);
+static int EnemyActorGetLod(int x, int y);
+static void EnemyActorSpawn(struct EnemyBatch *batch, int pool);
+static void EnemyActorDespawn(struct EnemyBatch *batch, int index);
+static bool EnemyActorIsInView(int x, int y, int margin);
+static void EnemyActorRun(struct EnemyBatch *batch, const struct EnemyBehaviour *behaviour, const int *indices, int count);
+static bool EnemyActorRunCode(struct EnemyBatch *batch, int index, const struct EnemyCode *code);
+static bool EnemyActorMove(struct EnemyBatch *batch, int index);
+static bool EnemyActorChase(struct EnemyBatch *batch, int index);
+static void EnemyActorFall(struct EnemyBatch *batch, int index);
+static void EnemyActorSweep(struct EnemyBatch *batch, int index, int movex, int movey, struct FieldSweep *sweep);
+static void EnemyActorSetFace(struct EnemyBatch *batch, int index, int face);
+static bool EnemyActorIs(struct EnemyBatch *batch, int index, int kind);
+static bool EnemyActorIsWall(struct EnemyBatch *batch, int index);
+static bool EnemyActorIsLedge(struct EnemyBatch *batch, int index);
+static bool EnemyActorIsGround(struct EnemyBatch *batch, int index);
+static int EnemyActorGetPlayerDistance(struct EnemyBatch *batch, int index);
+static void EnemyActorGetRect(struct EnemyBatch *batch, int index, struct Rect *rect);
+static void EnemyActorSetRect(struct EnemyBatch *batch, int index, const struct Rect *rect);
+static void EnemyActorCalc(struct EnemyBatch *batch);
 
 // 内部変数
 //
-static ActorFunction enemyFieldActorFunctions[kEnemyActionSize] = {
-    (ActorFunction)EnemyActorNull, 
-    (ActorFunction)EnemyActorIdle, 
-};
 static const char *enemyFieldAnimationNames_Walk[kEnemyFaceSize] = {
     "WalkLeft", 
     "WalkRight", 
@@ -45,41 +59,19 @@ void EnemyActorLoad(void)
         return;
     }
 
-    // エネミーの読み込み
-    for (int i = 0; i < kEnemyPoolSize; i++) {
-
-        // エネミーの取得
-        const struct EnemyData *data = &enemyDatas[enemy->pools[i].type];
-
-        // アクタの登録
-        struct EnemyActor *actor = (struct EnemyActor *)ActorLoad(enemyFieldActorFunctions[data->action], kGamePriorityEnemy);
-        if (actor == NULL) {
-            playdate->system->error("%s: %d: enemy actor is not loaded.", __FILE__, __LINE__);
-        }
-
-        // エネミーの初期化
-        {
-            // 解放処理の設定
-            ActorSetUnload(&actor->actor, (ActorFunction)EnemyActorUnload);
-
-            // タグの設定
-            ActorSetTag(&actor->actor, kGameTagEnemy);
-
-            // インデックスの設定
-            actor->index = i;
-
-            // データの設定
-            actor->data = data;
+    // アクタの登録
+    struct EnemyActor *actor = (struct EnemyActor *)ActorLoad((ActorFunction)EnemyActorLoop, kGamePriorityEnemy);
+    if (actor == NULL) {
+        playdate->system->error("%s: %d: enemy actor is not loaded.", __FILE__, __LINE__);
+    }
 
-            // 位置の設定
-            actor->position = enemy->pools[i].position;
+    // エネミーアクタの初期化
+    {
+        // 解放処理の設定
+        ActorSetUnload(&actor->actor, (ActorFunction)EnemyActorUnload);
 
-            // 点滅の設定
-            actor->blink = 0;
-            
-            // 計算
-            EnemyActorCalc(actor);
-        }
+        // タグの設定
+        ActorSetTag(&actor->actor, kGameTagEnemy);
     }
 }
 
@@ -93,8 +85,11 @@ static void EnemyActorUnload(struct EnemyActor *actor)
         return;
     }
 
-    // 位置の保存
-    enemy->pools[actor->index].position = actor->position;
+    // すべてのエネミーをプールに戻す
+    struct EnemyBatch *batch = &enemy->batch;
+    while (batch->size > 0) {
+        EnemyActorDespawn(batch, batch->size - 1);
+    }
 }
 
 // エネミーアクタを描画する
@@ -111,25 +106,278 @@ static void EnemyActorDraw(struct EnemyActor *actor)
     FieldSetClip();
 
     // スプライトの描画
-    if ((actor->blink & kEnemyBlinkInterval) == 0) {
-        struct Vector view;
-        GameGetFieldCameraPosition(actor->position.x, actor->position.y, &view);
-        AsepriteDrawRotatedSpriteAnimation(&actor->animation, view.x, view.y, 0.0f, actor->data->centerX, actor->data->centerY, 1.0f, 1.0f, kDrawModeCopy);
+    struct EnemyBatch *batch = &enemy->batch;
+    for (int i = 0; i < batch->size; i++) {
+        if ((batch->blinks[i] & kEnemyBlinkInterval) == 0) {
+            struct Vector view;
+            if (GameGetFieldSpritePosition(batch->positionXs[i], batch->positionYs[i], &batch->animations[i], batch->datas[i]->centerX, batch->datas[i]->centerY, &view)) {
+                AsepriteDrawRotatedSpriteAnimation(&batch->animations[i], view.x, view.y, 0.0f, batch->datas[i]->centerX, batch->datas[i]->centerY, 1.0f, 1.0f, kDrawModeCopy);
+            }
+        }
     }
 
     // クリップの解除
     FieldClearClip();
 }
 
-// エネミーアクタが何もしない
+// エネミーアクタを処理する
 //
-void EnemyActorNull(struct EnemyActor *actor)
+static void EnemyActorLoop(struct EnemyActor *actor)
 {
+    // Playdate の取得
+    PlaydateAPI *playdate = IocsGetPlaydate();
+    if (playdate == NULL) {
+        return;
+    }
+
+    // 前回の接触の反映（バッチの並びが変わる前に行う）
+    struct EnemyBatch *batch = &enemy->batch;
+    EnemyActorHit(batch);
+
+    // 出現と消滅
+    EnemyActorStream(batch);
+
+    // 詳細度の決定（プールのインデックスで更新するフレームをずらす）
+    bool updates[kEnemyBatchSize];
+    {
+        if (GameIsPlay()) {
+            ++batch->frame;
+        }
+        for (int i = 0; i < batch->size; i++) {
+            int lod = EnemyActorGetLod(batch->positionXs[i], batch->positionYs[i]);
+            int interval = batch->datas[i]->lodIntervals[lod];
+            if (interval <= 1 || batch->states[i] == 0) {
+                updates[i] = true;
+                batch->steps[i] = 1;
+            } else {
+                updates[i] = ((batch->frame + batch->indices[i]) & (interval - 1)) == 0 ? true : false;
+                batch->steps[i] = interval;
+            }
+            batch->lods[i] = lod;
+        }
+    }
+
+    // 振る舞いごとに一覧を作る
+    int starts[kEnemyBehaviourSize + 1];
+    {
+        memset(starts, 0, sizeof (starts));
+        for (int i = 0; i < batch->size; i++) {
+            if (updates[i] && batch->behaviours[i] != kEnemyBehaviourNull) {
+                ++starts[batch->behaviours[i] + 1];
+            }
+        }
+        for (int i = 0; i < enemy->behaviourSize; i++) {
+            starts[i + 1] += starts[i];
+        }
+        int counts[kEnemyBehaviourSize];
+        memcpy(counts, starts, sizeof (counts));
+        for (int i = 0; i < batch->size; i++) {
+            if (updates[i] && batch->behaviours[i] != kEnemyBehaviourNull) {
+                batch->behaviourIndices[counts[batch->behaviours[i]]++] = i;
+            }
+        }
+    }
+
+    // 振る舞いごとにまとめて実行する
+    for (int i = 0; i < enemy->behaviourSize; i++) {
+        int count = starts[i + 1] - starts[i];
+        if (count > 0) {
+            EnemyActorRun(batch, &enemy->behaviours[i], &batch->behaviourIndices[starts[i]], count);
+        }
+    }
+
+    // 計算
+    EnemyActorCalc(batch);
+
+    // 矩形の登録
+    if (GameIsPlay()) {
+        for (int i = 0; i < batch->size; i++) {
+            struct Rect rect = {
+                .left = batch->moveLefts[i], 
+                .top = batch->moveTops[i], 
+                .right = batch->moveRights[i], 
+                .bottom = batch->moveBottoms[i], 
+            };
+            HitAddRect(kHitCategoryEnemy, i, &rect);
+        }
+    }
+
+    // 描画処理の設定
+    ActorSetDraw(&actor->actor, (ActorFunction)EnemyActorDraw, kGameOrderEnemy);
+}
+
+// カメラの近くのエネミーを出現させ、離れたエネミーをプールに戻す
+//
+static void EnemyActorStream(struct EnemyBatch *batch)
+{
+    // 離れたエネミーの消滅
+    for (int i = batch->size - 1; i >= 0; i--) {
+        if (!EnemyActorIsInView(batch->positionXs[i], batch->positionYs[i], kEnemyStreamDespawn)) {
+            EnemyActorDespawn(batch, i);
+        }
+    }
+
+    // カメラの周りのセルの範囲
+    struct Vector *camera = GameGetCamera();
+    int x = camera->x % (kFieldSizeX * kFieldSizePixel);
+    if (x < 0) {
+        x += kFieldSizeX * kFieldSizePixel;
+    }
+    int left = (x + kFieldSizeX * kFieldSizePixel - kEnemyStreamSpawn) / kEnemyCellPixelX;
+    int right = (x + kFieldSizeX * kFieldSizePixel + kGameViewFieldSizeX + kEnemyStreamSpawn) / kEnemyCellPixelX;
+    int top = (camera->y - kEnemyStreamSpawn) / kEnemyCellPixelY;
+    int bottom = (camera->y + kGameViewFieldSizeY + kEnemyStreamSpawn) / kEnemyCellPixelY;
+    if (top < 0) {
+        top = 0;
+    }
+    if (bottom >= kEnemyCellSizeY) {
+        bottom = kEnemyCellSizeY - 1;
+    }
+
+    // 近づいたエネミーの出現
+    for (int cy = top; cy <= bottom; cy++) {
+        for (int cx = left; cx <= right; cx++) {
+            int *link = &enemy->cellHeads[cy][cx % kEnemyCellSizeX];
+            while (*link != kEnemyCellNull && batch->size < kEnemyBatchSize) {
+                int index = *link;
+                struct EnemyPool *pool = &enemy->pools[index];
+                if (pool->type != kEnemyTypeNull && EnemyActorIsInView(pool->position.x, pool->position.y, kEnemyStreamSpawn)) {
+                    *link = pool->next;
+                    EnemyActorSpawn(batch, index);
+                } else {
+                    link = &pool->next;
+                }
+            }
+        }
+    }
+}
+
+// 攻撃の当たったエネミーを点滅させる
+//
+static void EnemyActorHit(struct EnemyBatch *batch)
+{
+    const struct HitContact *contacts;
+    int size = HitGetContacts(kHitContactAttackEnemy, &contacts);
+    for (int i = 0; i < size; i++) {
+        int index = contacts[i].other;
+        if (index < batch->size && batch->blinks[index] == 0) {
+            batch->blinks[index] = kEnemyBlinkDamage;
+        }
+    }
 }
 
-// エネミーアクタが待機する
+// プールのエネミーをバッチに加える
 //
-void EnemyActorIdle(struct EnemyActor *actor)
+static void EnemyActorSpawn(struct EnemyBatch *batch, int pool)
+{
+    // Playdate の取得
+    PlaydateAPI *playdate = IocsGetPlaydate();
+    if (playdate == NULL) {
+        return;
+    }
+
+    // エネミーの設定
+    const struct EnemyPool *p = &enemy->pools[pool];
+    const struct EnemyData *data = &enemyDatas[p->type];
+    int index = batch->size++;
+    batch->indices[index] = pool;
+    batch->datas[index] = data;
+    batch->behaviours[index] = EnemyFindBehaviour(data->behaviour);
+    batch->states[index] = 0;
+    batch->pcs[index] = 0;
+    batch->timers[index] = kEnemyCodeTimerNull;
+    batch->lifes[index] = p->life;
+    batch->positionXs[index] = p->position.x;
+    batch->positionYs[index] = p->position.y;
+    batch->directions[index] = kDirectionDown;
+    batch->faces[index] = kEnemyFaceLeft;
+    batch->moveSpeeds[index] = data->speed;
+    batch->moveFractionXs[index] = 0;
+    batch->moveFractionYs[index] = 0;
+    batch->moveVectorYs[index] = 0;
+    batch->blinks[index] = 0;
+    batch->lods[index] = kEnemyLodScreen;
+    batch->steps[index] = 1;
+    batch->moveLefts[index] = p->position.x + data->rect.left;
+    batch->moveTops[index] = p->position.y + data->rect.top;
+    batch->moveRights[index] = p->position.x + data->rect.right;
+    batch->moveBottoms[index] = p->position.y + data->rect.bottom;
+
+    // 振る舞いの確認
+    if (batch->behaviours[index] == kEnemyBehaviourNull) {
+        playdate->system->error("%s: %d: enemy behaviour is not found: %s", __FILE__, __LINE__, data->behaviour);
+    }
+
+    // 振る舞いが始まるまでのアニメーションの開始
+    AsepriteStartSpriteAnimation(&batch->animations[index], data->sprite, enemyFieldAnimationNames_Walk[batch->faces[index]], true);
+}
+
+// バッチのエネミーをプールに戻す
+//
+static void EnemyActorDespawn(struct EnemyBatch *batch, int index)
+{
+    // 状態の保存
+    struct EnemyPool *pool = &enemy->pools[batch->indices[index]];
+    pool->life = batch->lifes[index];
+    pool->position.x = batch->positionXs[index];
+    pool->position.y = batch->positionYs[index];
+    EnemySleepPool(batch->indices[index]);
+
+    // 末尾のエネミーで詰める
+    int last = --batch->size;
+    if (index < last) {
+        batch->indices[index] = batch->indices[last];
+        batch->datas[index] = batch->datas[last];
+        batch->behaviours[index] = batch->behaviours[last];
+        batch->states[index] = batch->states[last];
+        batch->pcs[index] = batch->pcs[last];
+        batch->timers[index] = batch->timers[last];
+        batch->lifes[index] = batch->lifes[last];
+        batch->positionXs[index] = batch->positionXs[last];
+        batch->positionYs[index] = batch->positionYs[last];
+        batch->directions[index] = batch->directions[last];
+        batch->faces[index] = batch->faces[last];
+        batch->moveSpeeds[index] = batch->moveSpeeds[last];
+        batch->moveFractionXs[index] = batch->moveFractionXs[last];
+        batch->moveFractionYs[index] = batch->moveFractionYs[last];
+        batch->moveVectorYs[index] = batch->moveVectorYs[last];
+        batch->moveLefts[index] = batch->moveLefts[last];
+        batch->moveTops[index] = batch->moveTops[last];
+        batch->moveRights[index] = batch->moveRights[last];
+        batch->moveBottoms[index] = batch->moveBottoms[last];
+        batch->blinks[index] = batch->blinks[last];
+        batch->animations[index] = batch->animations[last];
+        batch->lods[index] = batch->lods[last];
+        batch->steps[index] = batch->steps[last];
+    }
+}
+
+// 位置から詳細度を取得する
+//
+static int EnemyActorGetLod(int x, int y)
+{
+    return 
+        EnemyActorIsInView(x, y, 0) ? kEnemyLodScreen : 
+        EnemyActorIsInView(x, y, kEnemyLodNearMargin) ? kEnemyLodNear : 
+        kEnemyLodFar;
+}
+
+// 位置が視界の近くにあるかどうかを判定する
+//
+static bool EnemyActorIsInView(int x, int y, int margin)
+{
+    struct Vector view;
+    GameGetFieldCameraPosition(x, y, &view);
+    return 
+        view.x >= kGameViewFieldLeft - margin && 
+        view.x <= kGameViewFieldRight + margin && 
+        view.y >= kGameViewFieldTop - margin && 
+        view.y <= kGameViewFieldBottom + margin ? true : false;
+}
+
+// 同じ振る舞いのエネミーをまとめて実行する
+//
+static void EnemyActorRun(struct EnemyBatch *batch, const struct EnemyBehaviour *behaviour, const int *indices, int count)
 {
     // Playdate の取得
     PlaydateAPI *playdate = IocsGetPlaydate();
@@ -138,61 +386,316 @@ void EnemyActorIdle(struct EnemyActor *actor)
     }
 
     // 初期化
-    if (actor->actor.state == 0) {
+    for (int i = 0; i < count; i++) {
+        int index = indices[i];
+        if (batch->states[index] == 0) {
 
-        // 向きの設定
-        actor->direction = kDirectionDown;
+            // 向きの設定
+            batch->directions[index] = kDirectionDown;
 
-        // 体の向きの設定
-        actor->face = IocsGetRandomBool(NULL) ? kEnemyFaceLeft : kEnemyFaceRight;
+            // 体の向きの設定
+            batch->faces[index] = IocsGetRandomBool(&enemy->random) ? kEnemyFaceLeft : kEnemyFaceRight;
 
-        // 計算
-        EnemyActorCalc(actor);
+            // アニメーションの開始
+            AsepriteStartSpriteAnimation(&batch->animations[index], batch->datas[index]->sprite, enemyFieldAnimationNames_Walk[batch->faces[index]], true);
 
-        // アニメーションの開始
-        AsepriteStartSpriteAnimation(&actor->animation, actor->data->sprite, enemyFieldAnimationNames_Walk[actor->face], true);
+            // 命令の開始
+            batch->pcs[index] = 0;
+            batch->timers[index] = kEnemyCodeTimerNull;
 
-        // 初期化の完了
-        ++actor->actor.state;
+            // 初期化の完了
+            ++batch->states[index];
+        }
     }
 
     // プレイ中
     if (GameIsPlay()) {
+        const struct EnemyCode *codes = &enemy->codes[behaviour->code];
+        for (int i = 0; i < count; i++) {
+            int index = indices[i];
+
+            // 命令の実行（待つ命令に当たるまで進める）
+            for (int step = 0; step < kEnemyCodeStepMaximum && batch->pcs[index] < behaviour->codeSize; step++) {
+                if (!EnemyActorRunCode(batch, index, &codes[batch->pcs[index]])) {
+                    break;
+                }
+            }
+
+            // 落下
+            EnemyActorFall(batch, index);
+
+            // 点滅（間引いたフレームの分も進める）
+            batch->blinks[index] = batch->blinks[index] > batch->steps[index] ? batch->blinks[index] - batch->steps[index] : 0;
+
+            // アニメーションの更新（見えていないときは止める）
+            if (batch->blinks[index] == 0 && batch->lods[index] == kEnemyLodScreen) {
+                AsepriteUpdateSpriteAnimation(&batch->animations[index]);
+            }
+        }
+    }
+}
+
+// 1 命令を実行する（次の命令へ続けるときは true を返す）
+//
+static bool EnemyActorRunCode(struct EnemyBatch *batch, int index, const struct EnemyCode *code)
+{
+    bool next = true;
+    switch (code->op) {
+
+    // 待つ
+    case kEnemyCodeWait:
+    // 歩く
+    case kEnemyCodeMove:
+    // 追う
+    case kEnemyCodeChase:
+        {
+            if (batch->timers[index] == kEnemyCodeTimerNull) {
+                batch->timers[index] = code->arg;
+            }
+            bool done = false;
+            if (code->op == kEnemyCodeMove) {
+                done = !EnemyActorMove(batch, index);
+            } else if (code->op == kEnemyCodeChase) {
+                done = !EnemyActorChase(batch, index);
+            }
+            batch->timers[index] -= batch->steps[index];
+            if (done || batch->timers[index] <= 0) {
+                batch->timers[index] = kEnemyCodeTimerNull;
+                ++batch->pcs[index];
+            } else {
+                next = false;
+            }
+        }
+        break;
+
+    // 向く
+    case kEnemyCodeFace:
+        {
+            int face = batch->faces[index];
+            if (code->kind == kEnemyCodeFacePlayer) {
+                face = EnemyActorGetPlayerDistance(batch, index) < 0 ? kEnemyFaceLeft : kEnemyFaceRight;
+            } else if (code->kind == kEnemyCodeFaceRandom) {
+                face = IocsGetRandomBool(&enemy->random) ? kEnemyFaceLeft : kEnemyFaceRight;
+            } else if (code->kind == kEnemyCodeFaceBack) {
+                face = face == kEnemyFaceLeft ? kEnemyFaceRight : kEnemyFaceLeft;
+            }
+            EnemyActorSetFace(batch, index, face);
+            ++batch->pcs[index];
+        }
+        break;
+
+    // 跳ぶ
+    case kEnemyCodeJump:
+        {
+            if (EnemyActorIsGround(batch, index)) {
+                batch->moveVectorYs[index] = -code->arg;
+            }
+            ++batch->pcs[index];
+        }
+        break;
 
-        // 点滅
-        if (!EnemyActorBlink(actor)) {
+    // 条件で飛ぶ
+    case kEnemyCodeIf:
+        {
+            batch->pcs[index] = EnemyActorIs(batch, index, code->kind) ? code->arg : batch->pcs[index] + 1;
+        }
+        break;
 
-            // アニメーションの更新
-            AsepriteUpdateSpriteAnimation(&actor->animation);
+    // 飛ぶ
+    case kEnemyCodeGoto:
+        {
+            batch->pcs[index] = code->arg;
         }
+        break;
 
-        // 計算
-        EnemyActorCalc(actor);
+    // その他
+    default:
+        {
+            ++batch->pcs[index];
+        }
+        break;
     }
+    return next;
+}
 
-    // 描画処理の設定
-    ActorSetDraw(&actor->actor, (ActorFunction)EnemyActorDraw, kGameOrderEnemy);
+// 向いている方へ歩く（壁か崖で止まったら false を返す）
+//
+static bool EnemyActorMove(struct EnemyBatch *batch, int index)
+{
+    int movex = batch->moveSpeeds[index] * batch->steps[index];
+    struct FieldSweep sweep;
+    EnemyActorSweep(batch, index, batch->faces[index] == kEnemyFaceLeft ? -movex : movex, 0, &sweep);
+    return sweep.normalX != 0 || (sweep.ground && EnemyActorIsLedge(batch, index)) ? false : true;
+}
+
+// ナビゲーションの辺に沿ってプレイヤを追う（追う辺がなければ false を返す）
+//
+static bool EnemyActorChase(struct EnemyBatch *batch, int index)
+{
+    // 足元の節点から目標に近づく辺の取得
+    struct NavEdge edge;
+    if (!NavGetChaseEdge((batch->moveLefts[index] + batch->moveRights[index]) / 2, batch->moveBottoms[index], &edge)) {
+        return false;
+    }
+
+    // 辺の行き先の方を向く
+    struct Vector position;
+    NavGetNodePosition(edge.node, &position);
+    int distance = (position.x - batch->positionXs[index]) % (kFieldSizeX * kFieldSizePixel);
+    if (distance < -kFieldSizeX * kFieldSizePixel / 2) {
+        distance += kFieldSizeX * kFieldSizePixel;
+    } else if (distance > kFieldSizeX * kFieldSizePixel / 2) {
+        distance -= kFieldSizeX * kFieldSizePixel;
+    }
+    if (distance != 0) {
+        EnemyActorSetFace(batch, index, distance < 0 ? kEnemyFaceLeft : kEnemyFaceRight);
+    }
+
+    // 跳ぶ辺なら地面から跳ぶ
+    if (edge.type == kNavEdgeJump && EnemyActorIsGround(batch, index)) {
+        batch->moveVectorYs[index] = -kEnemyCodeChaseJump;
+    }
+
+    // 歩く（落ちる辺では崖でも止まらない）
+    int movex = batch->moveSpeeds[index] * batch->steps[index];
+    struct FieldSweep sweep;
+    EnemyActorSweep(batch, index, batch->faces[index] == kEnemyFaceLeft ? -movex : movex, 0, &sweep);
+    return true;
+}
+
+// 重力で落ちる
+//
+static void EnemyActorFall(struct EnemyBatch *batch, int index)
+{
+    for (int i = 0; i < batch->steps[index]; i++) {
+
+        // 移動
+        struct FieldSweep sweep;
+        EnemyActorSweep(batch, index, 0, batch->moveVectorYs[index], &sweep);
+
+        // 天井と着地
+        if (sweep.normalY != 0 || (batch->moveVectorYs[index] >= 0 && sweep.ground)) {
+            batch->moveVectorYs[index] = 0;
+        }
+        if (sweep.ground && batch->moveVectorYs[index] == 0) {
+            break;
+        }
+
+        // 加速
+        batch->moveVectorYs[index] += kEnemySpeedGravity;
+        if (batch->moveVectorYs[index] > kEnemySpeedFallMaximum) {
+            batch->moveVectorYs[index] = kEnemySpeedFallMaximum;
+        }
+    }
+}
+
+// 矩形を掃引して位置を更新する
+//
+static void EnemyActorSweep(struct EnemyBatch *batch, int index, int movex, int movey, struct FieldSweep *sweep)
+{
+    struct Rect rect;
+    EnemyActorGetRect(batch, index, &rect);
+    struct Vector fraction = {
+        .x = batch->moveFractionXs[index], 
+        .y = batch->moveFractionYs[index], 
+    };
+    FieldSweepRect(&rect, &fraction, movex, movey, kFieldSweepFall, sweep);
+    batch->moveFractionXs[index] = fraction.x;
+    batch->moveFractionYs[index] = fraction.y;
+    EnemyActorSetRect(batch, index, &rect);
+}
+
+// 体の向きを変える
+//
+static void EnemyActorSetFace(struct EnemyBatch *batch, int index, int face)
+{
+    if (batch->faces[index] != face) {
+        batch->faces[index] = face;
+        AsepriteStartSpriteAnimation(&batch->animations[index], batch->datas[index]->sprite, enemyFieldAnimationNames_Walk[face], true);
+    }
+}
+
+// 条件を判定する
+//
+static bool EnemyActorIs(struct EnemyBatch *batch, int index, int kind)
+{
+    bool result = false;
+    if (kind == kEnemyCodeIfWall) {
+        result = EnemyActorIsWall(batch, index);
+    } else if (kind == kEnemyCodeIfLedge) {
+        result = EnemyActorIsLedge(batch, index);
+    } else if (kind == kEnemyCodeIfNear) {
+        int distance = EnemyActorGetPlayerDistance(batch, index);
+        result = distance >= -kEnemyCodeNear && distance <= kEnemyCodeNear ? true : false;
+    } else if (kind == kEnemyCodeIfGround) {
+        result = EnemyActorIsGround(batch, index);
+    } else if (kind == kEnemyCodeIfRandom) {
+        result = IocsGetRandomBool(&enemy->random);
+    }
+    return result;
+}
+static bool EnemyActorIsWall(struct EnemyBatch *batch, int index)
+{
+    struct Rect rect;
+    EnemyActorGetRect(batch, index, &rect);
+    return FieldMoveRect(&rect, batch->faces[index] == kEnemyFaceLeft ? kDirectionLeft : kDirectionRight, 1, FieldIsSpace, NULL) == 0 ? true : false;
+}
+static bool EnemyActorIsLedge(struct EnemyBatch *batch, int index)
+{
+    int x = batch->faces[index] == kEnemyFaceLeft ? batch->moveLefts[index] - 1 : batch->moveRights[index] + 1;
+    return FieldIsFall(x, batch->moveBottoms[index] + 1);
+}
+static bool EnemyActorIsGround(struct EnemyBatch *batch, int index)
+{
+    struct Rect rect;
+    EnemyActorGetRect(batch, index, &rect);
+    return FieldMoveRect(&rect, kDirectionDown, 1, FieldIsFall, NULL) == 0 ? true : false;
 }
 
-// 点滅する
+// プレイヤまでの横の距離を取得する
 //
-static bool EnemyActorBlink(struct EnemyActor *actor)
+static int EnemyActorGetPlayerDistance(struct EnemyBatch *batch, int index)
 {
-    if (actor->blink > 0) {
-        --actor->blink;
+    struct Vector position;
+    PlayerActorGetPosition(&position);
+    int distance = (position.x - batch->positionXs[index]) % (kFieldSizeX * kFieldSizePixel);
+    if (distance < -kFieldSizeX * kFieldSizePixel / 2) {
+        distance += kFieldSizeX * kFieldSizePixel;
+    } else if (distance > kFieldSizeX * kFieldSizePixel / 2) {
+        distance -= kFieldSizeX * kFieldSizePixel;
     }
-    return actor->blink > 0 ? true : false;
+    return distance;
+}
+
+// 矩形を取得する、矩形から位置を設定する
+//
+static void EnemyActorGetRect(struct EnemyBatch *batch, int index, struct Rect *rect)
+{
+    rect->left = batch->moveLefts[index];
+    rect->top = batch->moveTops[index];
+    rect->right = batch->moveRights[index];
+    rect->bottom = batch->moveBottoms[index];
+}
+static void EnemyActorSetRect(struct EnemyBatch *batch, int index, const struct Rect *rect)
+{
+    batch->moveLefts[index] = rect->left;
+    batch->moveTops[index] = rect->top;
+    batch->moveRights[index] = rect->right;
+    batch->moveBottoms[index] = rect->bottom;
+    batch->positionXs[index] = rect->left - batch->datas[index]->rect.left;
+    batch->positionYs[index] = rect->top - batch->datas[index]->rect.top;
 }
 
 // エネミーを計算する
 //
-static void EnemyActorCalc(struct EnemyActor *actor)
+static void EnemyActorCalc(struct EnemyBatch *batch)
 {
     // 移動の計算
-    {
-        actor->moveRect.left = actor->position.x + actor->data->rect.left;
-        actor->moveRect.top = actor->position.y + actor->data->rect.top;
-        actor->moveRect.right = actor->position.x + actor->data->rect.right;
-        actor->moveRect.bottom = actor->position.y + actor->data->rect.bottom;
+    for (int i = 0; i < batch->size; i++) {
+        const struct Rect *rect = &batch->datas[i]->rect;
+        batch->moveLefts[i] = batch->positionXs[i] + rect->left;
+        batch->moveTops[i] = batch->positionYs[i] + rect->top;
+        batch->moveRights[i] = batch->positionXs[i] + rect->right;
+        batch->moveBottoms[i] = batch->positionYs[i] + rect->bottom;
     }
 }
@@ -0,0 +1,274 @@
+// EnemyBehaviour.c - エネミーの振る舞い
+//
+
+// 外部参照
+//
+#include <string.h>
+#include <stdlib.h>
+#include "pd_api.h"
+#include "Iocs.h"
+#include "Enemy.h"
+
+// 内部関数
+//
+static void EnemyBehaviourJsonDecodeError(struct json_decoder *decoder, const char *error, int linenum);
+static void EnemyBehaviourJsonDidDecodeTableValue(struct json_decoder *decoder, const char *key, json_value value);
+static int EnemyBehaviourReadJson(void *userdata, uint8_t *buffer, int size);
+static void EnemyBehaviourAssemble(struct EnemyBehaviour *behaviour, const char *source);
+static bool EnemyBehaviourAssembleLine(struct EnemyCode *code, char *line);
+static int EnemyBehaviourFindName(const char *names[], int size, const char *name);
+
+// 内部変数
+//
+static const char *enemyBehaviourOpNames[kEnemyCodeOpSize] = {
+    "wait", 
+    "move", 
+    "face", 
+    "jump", 
+    "if", 
+    "goto", 
+    "chase", 
+};
+static const char *enemyBehaviourFaceNames[kEnemyCodeFaceSize] = {
+    "player", 
+    "random", 
+    "back", 
+};
+static const char *enemyBehaviourIfNames[kEnemyCodeIfSize] = {
+    "wall", 
+    "ledge", 
+    "near", 
+    "ground", 
+    "random", 
+};
+static const char *enemyBehaviourSeparators = ";\n";
+
+
+// 振る舞いを読み込む
+//
+void EnemyLoadBehaviours(const char *path)
+{
+    // Playdate の取得
+    PlaydateAPI *playdate = IocsGetPlaydate();
+    if (playdate == NULL) {
+        return;
+    }
+
+    // 振る舞いの初期化
+    enemy->behaviourSize = 0;
+    enemy->codeSize = 0;
+
+    // ファイルの読み込み
+    struct AsepriteJson json = {0};
+    {
+        FileStat stat;
+        if (playdate->file->stat(path, &stat) != 0) {
+            playdate->system->error("%s: %d: json is not loaded: %s", __FILE__, __LINE__, path);
+            return;
+        }
+        json.base = IocsRealloc(kIocsMemoryTagEnemy, NULL, stat.size);
+        if (json.base == NULL) {
+            playdate->system->error("%s: %d: json buffer is not allocated.", __FILE__, __LINE__);
+            return;
+        }
+        SDFile *file = playdate->file->open(path, kFileRead);
+        if (file == NULL) {
+            playdate->system->error("%s: %d: json is not opened: %s", __FILE__, __LINE__, path);
+            IocsRealloc(kIocsMemoryTagEnemy, json.base, 0);
+            return;
+        }
+        json.size = playdate->file->read(file, json.base, stat.size);
+        json.ptr = 0;
+        playdate->file->close(file);
+    }
+
+    // .json のデコード
+    {
+        struct json_decoder decoder = {
+            .decodeError = EnemyBehaviourJsonDecodeError, 
+            .didDecodeTableValue = EnemyBehaviourJsonDidDecodeTableValue, 
+        };
+        json_reader reader = {
+            .read = EnemyBehaviourReadJson, 
+            .userdata = &json, 
+        };
+        json_value value;
+        playdate->json->decode(&decoder, reader, &value);
+    }
+
+    // ファイルの解放
+    IocsRealloc(kIocsMemoryTagEnemy, json.base, 0);
+}
+
+// 名前から振る舞いを探す
+//
+int EnemyFindBehaviour(const char *name)
+{
+    int behaviour = kEnemyBehaviourNull;
+    if (name != NULL) {
+        for (int i = 0; i < enemy->behaviourSize; i++) {
+            if (strcmp(enemy->behaviours[i].name, name) == 0) {
+                behaviour = i;
+                break;
+            }
+        }
+    }
+    return behaviour;
+}
+
+// .json をデコードする
+//
+static void EnemyBehaviourJsonDecodeError(struct json_decoder *decoder, const char *error, int linenum)
+{
+    // Playdate の取得
+    PlaydateAPI *playdate = IocsGetPlaydate();
+    if (playdate == NULL) {
+        return;
+    }
+
+    // エラー
+    playdate->system->error("%s: %d: .json decode error: %d: %s", __FILE__, __LINE__, linenum, error);
+}
+static void EnemyBehaviourJsonDidDecodeTableValue(struct json_decoder *decoder, const char *key, json_value value)
+{
+    // Playdate の取得
+    PlaydateAPI *playdate = IocsGetPlaydate();
+    if (playdate == NULL) {
+        return;
+    }
+
+    // "name" で振る舞いを追加し、続く "code" を組み立てる
+    if (value.type == kJSONString) {
+        if (strcmp(key, "name") == 0) {
+            if (enemy->behaviourSize >= kEnemyBehaviourSize) {
+                playdate->system->error("%s: %d: behaviour is not entry: %s", __FILE__, __LINE__, value.data.stringval);
+                return;
+            }
+            struct EnemyBehaviour *behaviour = &enemy->behaviours[enemy->behaviourSize++];
+            strncpy(behaviour->name, value.data.stringval, kEnemyBehaviourNameSize - 1);
+            behaviour->name[kEnemyBehaviourNameSize - 1] = '\0';
+            behaviour->code = enemy->codeSize;
+            behaviour->codeSize = 0;
+        } else if (strcmp(key, "code") == 0 && enemy->behaviourSize > 0) {
+            EnemyBehaviourAssemble(&enemy->behaviours[enemy->behaviourSize - 1], value.data.stringval);
+        }
+    }
+}
+static int EnemyBehaviourReadJson(void *userdata, uint8_t *buffer, int size)
+{
+    struct AsepriteJson *json = (struct AsepriteJson *)userdata;
+    int length = json->size - json->ptr;
+    if (length > size) {
+        length = size;
+    }
+    if (length > 0) {
+        memcpy(buffer, &json->base[json->ptr], length);
+        json->ptr += length;
+    }
+    return length;
+}
+
+// 振る舞いの命令を組み立てる
+//
+static void EnemyBehaviourAssemble(struct EnemyBehaviour *behaviour, const char *source)
+{
+    // Playdate の取得
+    PlaydateAPI *playdate = IocsGetPlaydate();
+    if (playdate == NULL) {
+        return;
+    }
+
+    // 1 命令ずつ組み立てる
+    char line[64];
+    while (*source != '\0') {
+        int length = strcspn(source, enemyBehaviourSeparators);
+        if (length >= (int)sizeof (line)) {
+            length = sizeof (line) - 1;
+        }
+        memcpy(line, source, length);
+        line[length] = '\0';
+        source += length;
+        if (*source != '\0') {
+            ++source;
+        }
+        if (strspn(line, " \t\r") == strlen(line)) {
+            continue;
+        }
+        if (enemy->codeSize >= kEnemyCodeSize) {
+            playdate->system->error("%s: %d: behaviour code is over: %s", __FILE__, __LINE__, behaviour->name);
+            return;
+        }
+        if (!EnemyBehaviourAssembleLine(&enemy->codes[enemy->codeSize], line)) {
+            playdate->system->error("%s: %d: behaviour code is invalid: %s: %s", __FILE__, __LINE__, behaviour->name, line);
+            return;
+        }
+        ++enemy->codeSize;
+        ++behaviour->codeSize;
+    }
+
+    // 飛び先の確認
+    for (int i = behaviour->code; i < behaviour->code + behaviour->codeSize; i++) {
+        const struct EnemyCode *code = &enemy->codes[i];
+        if ((code->op == kEnemyCodeIf || code->op == kEnemyCodeGoto) && (code->arg < 0 || code->arg >= behaviour->codeSize)) {
+            playdate->system->error("%s: %d: behaviour label is out of range: %s: %d", __FILE__, __LINE__, behaviour->name, code->arg);
+        }
+    }
+}
+
+// 1 命令を組み立てる
+//
+static bool EnemyBehaviourAssembleLine(struct EnemyCode *code, char *line)
+{
+    // 命令と引数に分ける
+    const char *words[3] = {NULL, NULL, NULL, };
+    int wordSize = 0;
+    for (char *word = strtok(line, " \t\r"); word != NULL && wordSize < 3; word = strtok(NULL, " \t\r")) {
+        words[wordSize++] = word;
+    }
+    if (wordSize == 0) {
+        return false;
+    }
+
+    // 命令の取得
+    int op = EnemyBehaviourFindName(enemyBehaviourOpNames, kEnemyCodeOpSize, words[0]);
+    if (op < 0) {
+        return false;
+    }
+    code->op = op;
+    code->kind = 0;
+    code->arg = 0;
+
+    // 引数の取得
+    if (op == kEnemyCodeFace) {
+        int kind = wordSize > 1 ? EnemyBehaviourFindName(enemyBehaviourFaceNames, kEnemyCodeFaceSize, words[1]) : -1;
+        if (kind < 0) {
+            return false;
+        }
+        code->kind = kind;
+    } else if (op == kEnemyCodeIf) {
+        int kind = wordSize > 2 ? EnemyBehaviourFindName(enemyBehaviourIfNames, kEnemyCodeIfSize, words[1]) : -1;
+        if (kind < 0) {
+            return false;
+        }
+        code->kind = kind;
+        code->arg = (short)strtol(words[2], NULL, 0);
+    } else {
+        if (wordSize < 2) {
+            return false;
+        }
+        code->arg = (short)strtol(words[1], NULL, 0);
+    }
+    return true;
+}
+
+// 名前の一覧から探す
+//
+static int EnemyBehaviourFindName(const char *names[], int size, const char *name)
+{
+    for (int i = 0; i < size; i++) {
+        if (strcmp(names[i], name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
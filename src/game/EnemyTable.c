@@ -29,7 +29,7 @@ const struct EnemyData enemyDatas[kEnemyTypeSize] = {
         .name = "SKELETON", 
         .type = kEnemyTypeSkeleton, 
         .life = 3, 
-        .action = kEnemyActionIdle, 
+        .behaviour = "wander", 
         .speed = kEnemySpeed_0_5, 
         .rect.left = -12, 
         .rect.top = -23, 
@@ -38,6 +38,7 @@ const struct EnemyData enemyDatas[kEnemyTypeSize] = {
         .sprite = "skeleton", 
         .centerX = 0.5f, 
         .centerY = 1.0f, 
+        .lodIntervals = {1, 2, 4, }, 
     }, 
 };
 
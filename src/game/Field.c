@@ -6,18 +6,38 @@
 #include <string.h>
 #include "pd_api.h"
 #include "Iocs.h"
+#include "Scene.h"
 #include "Actor.h"
 #include "Aseprite.h"
 #include "Game.h"
 #include "Maze.h"
+#include "Path.h"
 #include "Field.h"
 
+// 生成コードの版数（Makefile が生成コードのハッシュを FieldVersion.h に書き出す）
+//
+#if __has_include("FieldVersion.h")
+#include "FieldVersion.h"
+#endif
+#ifndef FIELD_GENERATOR_VERSION
+#define FIELD_GENERATOR_VERSION __DATE__ " " __TIME__
+#endif
+
 // 内部関数
 //
 static void FieldBuildLocation(void);
 static void FieldUnbuildLocation(void);
-static void FieldBuildMap(void);
+static void FieldBuildMaze(void);
+static void FieldBuildRoute(void);
+static void FieldBuildSection(int routex, int routey);
+static void FieldBuildBuilding(void);
+static void FieldBuildDecoration(void);
+static void FieldBuildPath(void);
 static void FieldUnbuildMap(void);
+static uint32_t FieldGetCacheVersion(void);
+static char *FieldGetCachePath(uint32_t seed);
+static bool FieldLoadCache(uint32_t seed);
+static void FieldSaveCache(uint32_t seed);
 static void FieldLockLocation(int location);
 static void FieldDigLocation(int location);
 static void FieldActorUnload(struct FieldActor *actor);
@@ -33,10 +53,14 @@ static bool FieldIsMapLadder(unsigned char map);
 static bool FieldIsMapLock(unsigned char map);
 static bool FieldIsMapSpace(unsigned char map);
 static bool FieldIsMapFall(unsigned char map);
+static int FieldFloorTile(int pixel);
+static bool FieldSweepColumn(int x, int top, int bottom);
+static bool FieldSweepRow(int y, int left, int right, bool fall);
 
 // 内部変数
 //
 static struct Field *field = NULL;
+static const char *fieldCacheDirectory = "fields";
 static const char *fieldAnimationNames[kFieldAnimationSize] = {
     "Back", 
     "Back", 
@@ -103,7 +127,7 @@ static const char *fieldAnimationNames[kFieldAnimationSize] = {
 
 // フィールドを初期化する
 //
-void FieldInitialize(void)
+void FieldInitialize(uint32_t seed)
 {
     // Playdate の取得
     PlaydateAPI *playdate = IocsGetPlaydate();
@@ -117,22 +141,108 @@ void FieldInitialize(void)
     }
 
     // フィールドの作成
-    field = (struct Field *)playdate->system->realloc(NULL, sizeof (struct Field));
+    field = (struct Field *)SceneAllocate(sizeof (struct Field));
     if (field == NULL) {
         playdate->system->error("%s: %d: field instance is not created.", __FILE__, __LINE__);
     }
 
+    memset(field, 0, sizeof (struct Field));
+
     // フィールドの初期化
     {
         // 乱数の設定
-        IocsSetRandomSeed(&field->xorshift, 123456789);
+        field->seed = seed;
+        IocsSetRandomSeed(&field->random, seed);
+
+        // 作成の開始
+        field->build = FieldLoadCache(seed) ? kFieldBuildDone : kFieldBuildLocation;
+        field->buildSection = 0;
+    }
+}
+
+// フィールドを作成する
+//
+bool FieldBuild(int millisecond)
+{
+    // Playdate の取得
+    PlaydateAPI *playdate = IocsGetPlaydate();
+    if (playdate == NULL || field == NULL) {
+        return false;
+    }
+
+    // 時間の計測の開始（0 以下なら最後まで作成する）
+    unsigned int start = millisecond > 0 ? playdate->system->getCurrentTimeMilliseconds() : 0;
+
+    // 作成の再開
+    while (field->build != kFieldBuildDone) {
 
         // 配置の作成
-        FieldBuildLocation();
+        if (field->build == kFieldBuildLocation) {
+            FieldBuildLocation();
+            ++field->build;
+
+        // 迷路の作成
+        } else if (field->build == kFieldBuildMaze) {
+            FieldBuildMaze();
+            ++field->build;
 
-        // マップの作成
-        FieldBuildMap();
+        // 穴を掘る
+        } else if (field->build == kFieldBuildDig) {
+            if (MazeDigStep(field->maze, kFieldBuildDigStep)) {
+                ++field->build;
+            }
+
+        // 経路の作成
+        } else if (field->build == kFieldBuildRoute) {
+            FieldBuildRoute();
+            field->buildSection = 0;
+            ++field->build;
+
+        // 区画の作成
+        } else if (field->build == kFieldBuildSection) {
+            FieldBuildSection(field->buildSection % kFieldMazeSizeX, field->buildSection / kFieldMazeSizeX);
+            if (++field->buildSection >= kFieldMazeSizeX * kFieldMazeSizeY) {
+                ++field->build;
+            }
+
+        // 建物の作成
+        } else if (field->build == kFieldBuildBuilding) {
+            FieldBuildBuilding();
+            ++field->build;
+
+        // 装飾の作成
+        } else if (field->build == kFieldBuildDecoration) {
+            FieldBuildDecoration();
+            ++field->build;
+
+        // キャッシュの書き込み
+        } else if (field->build == kFieldBuildCache) {
+            FieldSaveCache(field->seed);
+            ++field->build;
+        }
+
+        // 時間の確認
+        if (millisecond > 0 && (int)(playdate->system->getCurrentTimeMilliseconds() - start) >= millisecond) {
+            break;
+        }
+    }
+
+    // 終了
+    return field->build == kFieldBuildDone ? true : false;
+}
+
+// フィールドの作成の進捗を取得する
+//
+int FieldGetBuildProgress(void)
+{
+    int progress = 0;
+    if (field != NULL) {
+        progress = field->build * 100 / kFieldBuildDone;
+        if (field->build == kFieldBuildSection) {
+            progress += field->buildSection * 100 / (kFieldMazeSizeX * kFieldMazeSizeY * kFieldBuildDone);
+        }
     }
+    return progress;
 }
 
 // フィールドを解放する
@@ -151,11 +261,15 @@ void FieldRelease(void)
     // 配置の解放
     FieldUnbuildLocation();
 
-    // フィールドの解放
-    if (field != NULL) {        
-        playdate->system->realloc(field, 0);
-        field = NULL;
-    }
+    // フィールドの解放（メモリはシーンのアリーナと一緒に解放される）
+    field = NULL;
+}
+
+// フィールドインスタンスを取得する
+//
+struct Field *FieldGetInstance(void)
+{
+    return field;
 }
 
 // 配置を作成する
@@ -171,7 +285,7 @@ static void FieldBuildLocation(void)
     }
     /*
     for (int i = 0; i < kFieldLocationSize; i++) {
-        int j = IocsGetRandomNumber(&field->xorshift) % kFieldLocationSize;
+        int j = IocsGetRandomNumber(&field->random) % kFieldLocationSize;
         struct Rect r = field->locations[j];
         field->locations[j] = field->locations[i];
         field->locations[i] = r;
@@ -212,10 +326,10 @@ static void FieldBuildLocation(void)
         int sizex = field->locations[i].right - locationx + 1;
         int sizey = field->locations[i].bottom - locationy + 1;
         if (sizex < kFieldLocationAreaSizeX - 1) {
-            areax += IocsGetRandomNumber(&field->xorshift) % ((kFieldLocationAreaSizeX - 1 - sizex));
+            areax += IocsGetRandomNumber(&field->random) % ((kFieldLocationAreaSizeX - 1 - sizex));
         }
         if (sizey < kFieldLocationAreaSizeY - 1) {
-            areay += IocsGetRandomNumber(&field->xorshift) % ((kFieldLocationAreaSizeY - 1 - sizey));
+            areay += IocsGetRandomNumber(&field->random) % ((kFieldLocationAreaSizeY - 1 - sizey));
         }
         field->locations[i].left = areax * kFieldSectionSizeX;
         field->locations[i].top = areay * kFieldSectionSizeY;
@@ -234,50 +348,52 @@ static void FieldUnbuildLocation(void)
     ;
 }
 
-// マップを作成する
+// 迷路を作成する
 //
-static void FieldBuildMap(void)
+static void FieldBuildMaze(void)
 {
     // 迷路の作成
-    {
-        // 初期化
-        field->maze = MazeLoad(kFieldMazeSizeX, kFieldMazeSizeY, &field->xorshift);
-
-        // ロック
-        {
-            // 開始位置をロック
-            FieldLockLocation(kFieldLocationStart);
+    field->maze = MazeLoad(kFieldMazeSizeX, kFieldMazeSizeY, &field->random);
 
-            // 洞窟をロック
-            for (int i = 0; i < kFieldLocationCaveSize; i++) {
-                FieldLockLocation(kFieldLocationCave + i);
-            }
-
-            // 城をロック
-            FieldLockLocation(kFieldLocationCastle);
+    // ロック
+    {
+        // 開始位置をロック
+        FieldLockLocation(kFieldLocationStart);
 
-            // 店をロック
-            for (int i = 0; i < kFieldLocationShopSize; i++) {
-                FieldLockLocation(kFieldLocationShop + i);
-            }
+        // 洞窟をロック
+        for (int i = 0; i < kFieldLocationCaveSize; i++) {
+            FieldLockLocation(kFieldLocationCave + i);
         }
 
-        // 穴を掘る
-        {
-            int x = (field->locations[kFieldLocationDig].left / kFieldSectionSizeX) * 2 + 1;
-            int y = (field->locations[kFieldLocationDig].top / kFieldSectionSizeY) * 2 + 1;
-            MazeDig(field->maze, x, y);
+        // 城をロック
+        FieldLockLocation(kFieldLocationCastle);
+
+        // 店をロック
+        for (int i = 0; i < kFieldLocationShopSize; i++) {
+            FieldLockLocation(kFieldLocationShop + i);
         }
+    }
 
-        // 経路の設定
-        MazeSetRoute(field->maze);
+    // 穴掘りの開始
+    {
+        int x = (field->locations[kFieldLocationDig].left / kFieldSectionSizeX) * 2 + 1;
+        int y = (field->locations[kFieldLocationDig].top / kFieldSectionSizeY) * 2 + 1;
+        MazeDigBegin(field->maze, x, y);
+    }
+}
 
-        // 中心の設定
-        for (int routey = 0; routey < field->maze->routeSize.y; routey++) {
-            for (int routex = 0; routex < field->maze->routeSize.x; routex++) {
-                field->os[routey][routex].x = IocsGetRandomNumber(&field->xorshift) % (kFieldSectionSizeX - 1) + 1;
-                field->os[routey][routex].y = IocsGetRandomNumber(&field->xorshift) % (kFieldSectionSizeY - 1) + 1;
-            }
+// 経路を作成する
+//
+static void FieldBuildRoute(void)
+{
+    // 経路の設定
+    MazeSetRoute(field->maze);
+
+    // 中心の設定
+    for (int routey = 0; routey < field->maze->routeSize.y; routey++) {
+        for (int routex = 0; routex < field->maze->routeSize.x; routex++) {
+            field->os[routey][routex].x = IocsGetRandomNumber(&field->random) % (kFieldSectionSizeX - 1) + 1;
+            field->os[routey][routex].y = IocsGetRandomNumber(&field->random) % (kFieldSectionSizeY - 1) + 1;
         }
     }
 
@@ -289,187 +405,190 @@ static void FieldBuildMap(void)
             }
         }
     }
+}
 
-    // マップの作成
-    {
-        for (int routey = 0; routey < field->maze->routeSize.y; routey++) {
-            int mapy = routey * kFieldSectionSizeY;
-            for (int routex = 0; routex < field->maze->routeSize.x; routex++) {
-                int mapx = routex * kFieldSectionSizeX;
-                unsigned char route = field->maze->routes[routey * field->maze->routeSize.x + routex];
-                if (route == 0) {
-                    for (int y = 0; y < kFieldSectionSizeY; y++) {
-                        for (int x = 0; x < kFieldSectionSizeX; x++) {
-                            field->maps[mapy + y][mapx + x] = kFieldMapBlock;
-                        }
+// 区画のマップを作成する
+//
+static void FieldBuildSection(int routex, int routey)
+{
+    int mapy = routey * kFieldSectionSizeY;
+    int mapx = routex * kFieldSectionSizeX;
+    unsigned char route = field->maze->routes[routey * field->maze->routeSize.x + routex];
+    if (route == 0) {
+        for (int y = 0; y < kFieldSectionSizeY; y++) {
+            for (int x = 0; x < kFieldSectionSizeX; x++) {
+                field->maps[mapy + y][mapx + x] = kFieldMapBlock;
+            }
+        }
+    } else if (route == (kMazeRouteUp | kMazeRouteDown)) {
+        int x = field->os[routey - 1][routex].x;
+        int y = 0;
+        while (y < field->os[routey][routex].y) {
+            field->maps[mapy + y][mapx + x] = kFieldMapLadder;
+            ++y;
+        }
+        do {
+            field->maps[mapy + y][mapx + x] = kFieldMapBlock;
+            x = x + (x < field->os[routey][routex].x ? 1 : -1);
+        } while (x != field->os[routey][routex].x);
+        while (y < kFieldSectionSizeY) {
+            field->maps[mapy + y][mapx + x] = kFieldMapLadder;
+            ++y;
+        }
+    } else if (route == kMazeRouteUp) {
+        {
+            int x = field->os[routey - 1][routex].x;
+            for (int y = 0; y < field->os[routey][routex].y; y++) {
+                field->maps[mapy + y][mapx + x] = kFieldMapLadder;
+            }
+        }
+        {
+            int y = field->os[routey][routex].y;
+            for (int x = 0; x < kFieldSectionSizeX; x++) {
+                field->maps[mapy + y][mapx + x] = kFieldMapBlock;
+            }
+        }
+    } else if (route == kMazeRouteDown) {
+        {
+            int y = field->os[routey][routex].y;
+            for (int x = 0; x < kFieldSectionSizeX; x++) {
+                field->maps[mapy + y][mapx + x] = kFieldMapBlock;
+            }
+        }
+        {
+            int x = field->os[routey][routex].x;
+            for (int y = field->os[routey][routex].y; y < kFieldSectionSizeY; y++) {
+                field->maps[mapy + y][mapx + x] = kFieldMapLadder;
+            }
+        }
+    } else {
+        unsigned char lr = route & (kMazeRouteLeft | kMazeRouteRight);
+        if (lr == kMazeRouteLeft) {
+            int x = 0;
+            int y = field->os[routey][routex - 1].y;
+            if (y < field->os[routey][routex].y) {
+                while (y < field->os[routey][routex].y) {
+                    field->maps[mapy + y][mapx + x] = kFieldMapLadder;
+                    ++y;
+                }
+            } else if (y > field->os[routey][routex].y) {
+                field->maps[mapy + y][mapx + x] = kFieldMapBlock;
+                do {
+                    --y;
+                    field->maps[mapy + y][mapx + x] = kFieldMapLadder;
+                } while (y > field->os[routey][routex].y);
+                ++x;
+            }
+            int t = routey > 0 && field->os[routey - 1][routex].x > field->os[routey][routex].x ? field->os[routey - 1][routex].x : field->os[routey][routex].x;
+            while (x <= t) {
+                field->maps[mapy + y][mapx + x] = kFieldMapBlock;
+                ++x;
+            }
+            if (routey >= field->maze->routeSize.y - 1) {
+                while (y < kFieldSectionSizeY) {
+                    field->maps[mapy + y][mapx + t] = kFieldMapLadder;
+                    ++y;
+                }
+            }
+        } else if (lr == kMazeRouteRight) {
+            int y = field->os[routey][routex].y;
+            int t = routey > 0 && field->os[routey - 1][routex].x < field->os[routey][routex].x ? field->os[routey - 1][routex].x : field->os[routey][routex].x;
+            for (int x = t; x < kFieldSectionSizeX; x++) {
+                field->maps[mapy + y][mapx + x] = kFieldMapBlock;
+            }
+            if (routey >= field->maze->routeSize.y - 1) {
+                while (y < kFieldSectionSizeY) {
+                    field->maps[mapy + y][mapx + t] = kFieldMapLadder;
+                    ++y;
+                }
+            }
+        } else {
+            int y = field->os[routey][routex - 1].y;
+            int h = y - field->os[routey][routex].y;
+            if (h < 0) {
+                h = -h;
+                if (h > field->os[routey][routex].x) {
+                    int x = 0;
+                    while (x < field->os[routey][routex].x) {
+                        field->maps[mapy + y][mapx + x] = kFieldMapBlock;
+                        ++x;
                     }
-                } else if (route == (kMazeRouteUp | kMazeRouteDown)) {
-                    int x = field->os[routey - 1][routex].x;
-                    int y = 0;
                     while (y < field->os[routey][routex].y) {
                         field->maps[mapy + y][mapx + x] = kFieldMapLadder;
                         ++y;
                     }
-                    do {
+                    while (x < kFieldSectionSizeX) {
                         field->maps[mapy + y][mapx + x] = kFieldMapBlock;
-                        x = x + (x < field->os[routey][routex].x ? 1 : -1);
-                    } while (x != field->os[routey][routex].x);
-                    while (y < kFieldSectionSizeY) {
+                        ++x;
+                    }
+                } else {
+                    int x = 0;
+                    do {
                         field->maps[mapy + y][mapx + x] = kFieldMapLadder;
                         ++y;
+                        field->maps[mapy + y][mapx + x] = kFieldMapBlock;
+                        ++x;
+                    } while (y < field->os[routey][routex].y);
+                    while (x < kFieldSectionSizeX) {
+                        field->maps[mapy + y][mapx + x] = kFieldMapBlock;
+                        ++x;
                     }
-                } else if (route == kMazeRouteUp) {
-                    {
-                        int x = field->os[routey - 1][routex].x;
-                        for (int y = 0; y < field->os[routey][routex].y; y++) {
-                            field->maps[mapy + y][mapx + x] = kFieldMapLadder;
-                        }
-                    }
-                    {
-                        int y = field->os[routey][routex].y;
-                        for (int x = 0; x < kFieldSectionSizeX; x++) {
-                            field->maps[mapy + y][mapx + x] = kFieldMapBlock;
-                        }
-                    }
-                } else if (route == kMazeRouteDown) {
-                    {
-                        int y = field->os[routey][routex].y;
-                        for (int x = 0; x < kFieldSectionSizeX; x++) {
-                            field->maps[mapy + y][mapx + x] = kFieldMapBlock;
-                        }
+                }
+            } else if (y > field->os[routey][routex].y) {
+                if (h > field->os[routey][routex].x) {
+                    int x = 0;
+                    do {
+                        field->maps[mapy + y][mapx + x] = kFieldMapBlock;
+                        ++x;
+                    } while (x < field->os[routey][routex].x);
+                    --x;
+                    while (y > field->os[routey][routex].y) {
+                        --y;
+                        field->maps[mapy + y][mapx + x] = kFieldMapLadder;
                     }
-                    {
-                        int x = field->os[routey][routex].x;
-                        for (int y = field->os[routey][routex].y; y < kFieldSectionSizeY; y++) {
-                            field->maps[mapy + y][mapx + x] = kFieldMapLadder;
-                        }
+                    ++x;
+                    while (x < kFieldSectionSizeX) {
+                        field->maps[mapy + y][mapx + x] = kFieldMapBlock;
+                        ++x;
                     }
                 } else {
-                    unsigned char lr = route & (kMazeRouteLeft | kMazeRouteRight);
-                    if (lr == kMazeRouteLeft) {
-                        int x = 0;
-                        int y = field->os[routey][routex - 1].y;
-                        if (y < field->os[routey][routex].y) {
-                            while (y < field->os[routey][routex].y) {
-                                field->maps[mapy + y][mapx + x] = kFieldMapLadder;
-                                ++y;
-                            }
-                        } else if (y > field->os[routey][routex].y) {
-                            field->maps[mapy + y][mapx + x] = kFieldMapBlock;
-                            do {
-                                --y;
-                                field->maps[mapy + y][mapx + x] = kFieldMapLadder;
-                            } while (y > field->os[routey][routex].y);
-                            ++x;
-                        }
-                        int t = routey > 0 && field->os[routey - 1][routex].x > field->os[routey][routex].x ? field->os[routey - 1][routex].x : field->os[routey][routex].x;
-                        while (x <= t) {
-                            field->maps[mapy + y][mapx + x] = kFieldMapBlock;
-                            ++x;
-                        }
-                        if (routey >= field->maze->routeSize.y - 1) {
-                            while (y < kFieldSectionSizeY) {
-                                field->maps[mapy + y][mapx + t] = kFieldMapLadder;
-                                ++y;
-                            }
-                        }
-                    } else if (lr == kMazeRouteRight) {
-                        int y = field->os[routey][routex].y;
-                        int t = routey > 0 && field->os[routey - 1][routex].x < field->os[routey][routex].x ? field->os[routey - 1][routex].x : field->os[routey][routex].x;
-                        for (int x = t; x < kFieldSectionSizeX; x++) {
-                            field->maps[mapy + y][mapx + x] = kFieldMapBlock;
-                        }
-                        if (routey >= field->maze->routeSize.y - 1) {
-                            while (y < kFieldSectionSizeY) {
-                                field->maps[mapy + y][mapx + t] = kFieldMapLadder;
-                                ++y;
-                            }
-                        }
-                    } else {
-                        int y = field->os[routey][routex - 1].y;
-                        int h = y - field->os[routey][routex].y;
-                        if (h < 0) {
-                            h = -h;
-                            if (h > field->os[routey][routex].x) {
-                                int x = 0;
-                                while (x < field->os[routey][routex].x) {
-                                    field->maps[mapy + y][mapx + x] = kFieldMapBlock;
-                                    ++x;
-                                }
-                                while (y < field->os[routey][routex].y) {
-                                    field->maps[mapy + y][mapx + x] = kFieldMapLadder;
-                                    ++y;
-                                }
-                                while (x < kFieldSectionSizeX) {
-                                    field->maps[mapy + y][mapx + x] = kFieldMapBlock;
-                                    ++x;
-                                }
-                            } else {
-                                int x = 0;
-                                do {
-                                    field->maps[mapy + y][mapx + x] = kFieldMapLadder;
-                                    ++y;
-                                    field->maps[mapy + y][mapx + x] = kFieldMapBlock;
-                                    ++x;
-                                } while (y < field->os[routey][routex].y);
-                                while (x < kFieldSectionSizeX) {
-                                    field->maps[mapy + y][mapx + x] = kFieldMapBlock;
-                                    ++x;
-                                }
-                            }
-                        } else if (y > field->os[routey][routex].y) {
-                            if (h > field->os[routey][routex].x) {
-                                int x = 0;
-                                do {
-                                    field->maps[mapy + y][mapx + x] = kFieldMapBlock;
-                                    ++x;
-                                } while (x < field->os[routey][routex].x);
-                                --x;
-                                while (y > field->os[routey][routex].y) {
-                                    --y;
-                                    field->maps[mapy + y][mapx + x] = kFieldMapLadder;
-                                }
-                                ++x;
-                                while (x < kFieldSectionSizeX) {
-                                    field->maps[mapy + y][mapx + x] = kFieldMapBlock;
-                                    ++x;
-                                }
-                            } else {
-                                int x = 0;
-                                do {
-                                    field->maps[mapy + y][mapx + x] = kFieldMapBlock;
-                                    --y;
-                                    field->maps[mapy + y][mapx + x] = kFieldMapLadder;
-                                    ++x;
-                                } while (y > field->os[routey][routex].y);
-                                while (x < kFieldSectionSizeX) {
-                                    field->maps[mapy + y][mapx + x] = kFieldMapBlock;
-                                    ++x;
-                                }
-                            }
-                        } else {
-                            for (int x = 0; x < kFieldSectionSizeX; x++) {
-                                field->maps[mapy + y][mapx + x] = kFieldMapBlock;
-                            }
-                        }
-                    }
-                    if ((route & kMazeRouteUp) != 0) {
-                        int x = field->os[routey - 1][routex].x;
-                        for (int y = 0; y < field->os[routey][routex].y; y++) {
-                            field->maps[mapy + y][mapx + x] = kFieldMapLadder;
-                        }
-                    }
-                    if ((route & kMazeRouteDown) != 0) {
-                        int x = field->os[routey][routex].x;
-                        for (int y = field->os[routey][routex].y; y < kFieldSectionSizeY; y++) {
-                            field->maps[mapy + y][mapx + x] = kFieldMapLadder;
-                        }
+                    int x = 0;
+                    do {
+                        field->maps[mapy + y][mapx + x] = kFieldMapBlock;
+                        --y;
+                        field->maps[mapy + y][mapx + x] = kFieldMapLadder;
+                        ++x;
+                    } while (y > field->os[routey][routex].y);
+                    while (x < kFieldSectionSizeX) {
+                        field->maps[mapy + y][mapx + x] = kFieldMapBlock;
+                        ++x;
                     }
                 }
+            } else {
+                for (int x = 0; x < kFieldSectionSizeX; x++) {
+                    field->maps[mapy + y][mapx + x] = kFieldMapBlock;
+                }
+            }
+        }
+        if ((route & kMazeRouteUp) != 0) {
+            int x = field->os[routey - 1][routex].x;
+            for (int y = 0; y < field->os[routey][routex].y; y++) {
+                field->maps[mapy + y][mapx + x] = kFieldMapLadder;
+            }
+        }
+        if ((route & kMazeRouteDown) != 0) {
+            int x = field->os[routey][routex].x;
+            for (int y = field->os[routey][routex].y; y < kFieldSectionSizeY; y++) {
+                field->maps[mapy + y][mapx + x] = kFieldMapLadder;
             }
         }
     }
+}
 
+// 建物を作成する
+//
+static void FieldBuildBuilding(void)
+{
     // ロックした場所を開ける
     {
         // 開始位置を開ける
@@ -528,7 +647,12 @@ static void FieldBuildMap(void)
             }
         }
     }
+}
 
+// 装飾を作成する
+//
+static void FieldBuildDecoration(void)
+{
     // 着地できる梯子を設定する
     for (int y = 1; y < kFieldSizeY; y++) {
         for (int x = 0; x < kFieldSizeX; x++) {
@@ -596,6 +720,27 @@ static void FieldBuildMap(void)
     }
 }
 
+// 経路探索を作成する（最初に経路を探すときに作る）
+//
+static void FieldBuildPath(void)
+{
+    // 区画を抽象グラフの単位にする
+    field->path = PathLoad(kFieldSizeX, kFieldSizeY, kFieldSectionSizeX, kFieldSectionSizeY);
+
+    // 通れる位置の設定
+    for (int y = 0; y < kFieldSizeY; y++) {
+        for (int x = 0; x < kFieldSizeX; x++) {
+            PathSetSpace(field->path, x, y, FieldIsMapSpace(field->maps[y][x]));
+        }
+    }
+
+    // 入口と区画内の経路の作成
+    PathBuild(field->path);
+    for (int i = 0; i < kFieldMazeSizeX * kFieldMazeSizeY; i++) {
+        PathBuildSection(field->path, i);
+    }
+}
+
 // マップを解放する
 //
 static void FieldUnbuildMap(void)
@@ -609,7 +754,142 @@ static void FieldUnbuildMap(void)
     // 迷路の解放
     if (field != NULL) {
         MazeUnload(field->maze);
+        field->maze = NULL;
+    }
+
+    // 経路探索の解放
+    if (field != NULL) {
+        PathUnload(field->path);
+        field->path = NULL;
+    }
+}
+
+// キャッシュの版数を取得する
+//
+static uint32_t FieldGetCacheVersion(void)
+{
+    // 生成コードの版数と形式の大きさから FNV-1a でハッシュを作る
+    const char *version = FIELD_GENERATOR_VERSION;
+    uint32_t hash = 2166136261u;
+    while (*version != '\0') {
+        hash = (hash ^ (unsigned char)*version++) * 16777619u;
+    }
+    hash = (hash ^ (uint32_t)sizeof (struct FieldCache)) * 16777619u;
+    return hash;
+}
+
+// キャッシュのパスを取得する
+//
+static char *FieldGetCachePath(uint32_t seed)
+{
+    char *path = NULL;
+    IocsGetPlaydate()->system->formatString(&path, "%s/%08x.bin", fieldCacheDirectory, (unsigned int)seed);
+    return path;
+}
+
+// キャッシュを読み込む
+//
+static bool FieldLoadCache(uint32_t seed)
+{
+    // Playdate の取得
+    PlaydateAPI *playdate = IocsGetPlaydate();
+    if (playdate == NULL) {
+        return false;
+    }
+
+    // ファイルの確認
+    char *path = FieldGetCachePath(seed);
+    FileStat stat;
+    if (path == NULL || playdate->file->stat(path, &stat) != 0 || stat.size != sizeof (struct FieldCache)) {
+        if (path != NULL) {
+            playdate->system->realloc(path, 0);
+        }
+        return false;
+    }
+
+    // ファイルの読み込み
+    bool result = false;
+    struct FieldCache *cache = (struct FieldCache *)IocsRealloc(kIocsMemoryTagField, NULL, sizeof (struct FieldCache));
+    if (cache != NULL) {
+        SDFile *file = playdate->file->open(path, kFileReadData);
+        if (file != NULL) {
+            if (
+                playdate->file->read(file, cache, sizeof (struct FieldCache)) == sizeof (struct FieldCache) && 
+                cache->magic == kFieldCacheMagic && 
+                cache->version == FieldGetCacheVersion() && 
+                cache->seed == seed
+            ) {
+                result = true;
+            }
+            playdate->file->close(file);
+        }
+    }
+
+    // フィールドの復元
+    if (result) {
+        field->random = cache->random;
+        memcpy(field->os, cache->os, sizeof (field->os));
+        memcpy(field->maps, cache->maps, sizeof (field->maps));
+        memcpy(field->locations, cache->locations, sizeof (field->locations));
+        field->locationEnemy = cache->locationEnemy;
+        field->maze = MazeLoad(kFieldMazeSizeX, kFieldMazeSizeY, &field->random);
+        memcpy(field->maze->maps, cache->mazeMaps, sizeof (cache->mazeMaps));
+        memcpy(field->maze->routes, cache->mazeRoutes, sizeof (cache->mazeRoutes));
+    }
+
+    // キャッシュの解放
+    if (cache != NULL) {
+        IocsRealloc(kIocsMemoryTagField, cache, 0);
+    }
+    playdate->system->realloc(path, 0);
+
+    // 終了
+    return result;
+}
+
+// キャッシュを書き込む
+//
+static void FieldSaveCache(uint32_t seed)
+{
+    // Playdate の取得
+    PlaydateAPI *playdate = IocsGetPlaydate();
+    if (playdate == NULL) {
+        return;
     }
+
+    // キャッシュの作成
+    struct FieldCache *cache = (struct FieldCache *)IocsRealloc(kIocsMemoryTagField, NULL, sizeof (struct FieldCache));
+    if (cache == NULL) {
+        return;
+    }
+    memset(cache, 0, sizeof (struct FieldCache));
+    cache->magic = kFieldCacheMagic;
+    cache->version = FieldGetCacheVersion();
+    cache->seed = seed;
+    cache->random = field->random;
+    memcpy(cache->os, field->os, sizeof (cache->os));
+    memcpy(cache->maps, field->maps, sizeof (cache->maps));
+    memcpy(cache->locations, field->locations, sizeof (cache->locations));
+    cache->locationEnemy = field->locationEnemy;
+    memcpy(cache->mazeMaps, field->maze->maps, sizeof (cache->mazeMaps));
+    memcpy(cache->mazeRoutes, field->maze->routes, sizeof (cache->mazeRoutes));
+
+    // ファイルの書き込み
+    char *path = FieldGetCachePath(seed);
+    if (path != NULL) {
+        playdate->file->mkdir(fieldCacheDirectory);
+        SDFile *file = playdate->file->open(path, kFileWrite);
+        if (file != NULL) {
+            if (playdate->file->write(file, cache, sizeof (struct FieldCache)) != sizeof (struct FieldCache)) {
+                playdate->system->logToConsole("%s: %d: field cache is not written: %s", __FILE__, __LINE__, path);
+            }
+            playdate->file->close(file);
+        }
+        playdate->system->realloc(path, 0);
+    }
+
+    // キャッシュの解放
+    IocsRealloc(kIocsMemoryTagField, cache, 0);
 }
 
 // 指定した配置をロックする
@@ -717,7 +997,7 @@ void FieldActorLoad(void)
         ActorSetTag(&actor->actor, kGameTagField);
 
         // スプライトの作成
-        actor->animations = (struct AsepriteSpriteAnimation *)playdate->system->realloc(NULL, kFieldAnimationSize * sizeof (struct AsepriteSpriteAnimation));
+        actor->animations = (struct AsepriteSpriteAnimation *)IocsRealloc(kIocsMemoryTagField, NULL, kFieldAnimationSize * sizeof (struct AsepriteSpriteAnimation));
         if (actor->animations == NULL) {
             playdate->system->error("%s: %d: field actor animation is not created.", __FILE__, __LINE__);
         }
@@ -737,7 +1017,7 @@ static void FieldActorUnload(struct FieldActor *actor)
 
     // スプライトの解放
     if (actor->animations != NULL) {
-        playdate->system->realloc(actor->animations, 0);
+        IocsRealloc(kIocsMemoryTagField, actor->animations, 0);
     }
 }
 
@@ -781,9 +1061,6 @@ static void FieldActorDraw(struct FieldActor *actor)
 
     // クリップの解除
     FieldClearClip();
-
-    // DEBUG
-    playdate->system->drawFPS(0, 0);
 }
 
 // フィールドアクタが待機する
@@ -861,6 +1138,26 @@ static int FieldGetMapY(int y)
     return FieldAdjustY(y) / kFieldSizePixel;
 }
 
+// 経路を探す
+//
+int FieldFindPath(int fromx, int fromy, int tox, int toy, struct Vector *positions, int size)
+{
+    int result = kPathNull;
+    if (field != NULL && field->build == kFieldBuildDone) {
+        if (field->path == NULL) {
+            FieldBuildPath();
+        }
+        if (fromy >= 0 && fromy < kFieldSizeY * kFieldSizePixel && toy >= 0 && toy < kFieldSizeY * kFieldSizePixel) {
+            result = PathFind(field->path, FieldGetMapX(fromx), FieldGetMapY(fromy), FieldGetMapX(tox), FieldGetMapY(toy), positions, size);
+            for (int i = 0; i < result; i++) {
+                positions[i].x = positions[i].x * kFieldSizePixel + kFieldSizePixel / 2;
+                positions[i].y = positions[i].y * kFieldSizePixel + kFieldSizePixel / 2;
+            }
+        }
+    }
+    return result;
+}
+
 // フィールドマップを判定する
 //
 static bool FieldIsMapBack(unsigned char map)
@@ -1090,6 +1387,159 @@ int FieldMoveRect(struct Rect *from, int direction, int distance, FieldIsFunctio
     return vector.x != 0 ? abs(vector.x) : abs(vector.y);
 }
 
+// 矩形を 8.8 固定小数点で掃引して、タイルの境界を越えるときだけ判定する
+//
+void FieldSweepRect(struct Rect *rect, struct Vector *fraction, int movex, int movey, int flags, struct FieldSweep *sweep)
+{
+    // 固定小数点の左上と大きさ
+    int width = rect->right - rect->left;
+    int height = rect->bottom - rect->top;
+    int left = (FieldAdjustX(rect->left) << kFieldSweepShift) + (fraction->x & kFieldSweepMask);
+    int top = (rect->top << kFieldSweepShift) + (fraction->y & kFieldSweepMask);
+
+    // 残りの移動量
+    int signx = movex < 0 ? -1 : 1;
+    int signy = movey < 0 ? -1 : 1;
+    int restx = movex * signx;
+    int resty = movey * signy;
+    sweep->normalX = 0;
+    sweep->normalY = 0;
+
+    // 止まった軸の残り（もう一方の軸を進めたあとで 1 度だけやり直す）
+    int pendingx = 0;
+    int pendingy = 0;
+    bool retry = false;
+
+    // 先に境界を越える軸から順に進める
+    while (restx > 0 || resty > 0 || (!retry && (pendingx > 0 || pendingy > 0))) {
+
+        // 角に引っかかった軸のやり直し
+        if (restx == 0 && resty == 0) {
+            restx = pendingx;
+            resty = pendingy;
+            if (restx > 0) {
+                sweep->normalX = 0;
+            }
+            if (resty > 0) {
+                sweep->normalY = 0;
+            }
+            retry = true;
+        }
+
+        // 次のタイルに入るまでの距離
+        int dx = restx + 1;
+        if (restx > 0) {
+            if (signx > 0) {
+                int right = (left >> kFieldSweepShift) + width;
+                dx = (((FieldFloorTile(right) + 1) * kFieldSizePixel) << kFieldSweepShift) - (left + (width << kFieldSweepShift));
+            } else {
+                dx = left - ((FieldFloorTile(left >> kFieldSweepShift) * kFieldSizePixel) << kFieldSweepShift) + 1;
+            }
+        }
+        int dy = resty + 1;
+        if (resty > 0) {
+            if (signy > 0) {
+                int bottom = (top >> kFieldSweepShift) + height;
+                dy = (((FieldFloorTile(bottom) + 1) * kFieldSizePixel) << kFieldSweepShift) - (top + (height << kFieldSweepShift));
+            } else {
+                dy = top - ((FieldFloorTile(top >> kFieldSweepShift) * kFieldSizePixel) << kFieldSweepShift) + 1;
+            }
+        }
+
+        // 境界を越えなければ残りを進めて終わる
+        bool crossx = dx <= restx ? true : false;
+        bool crossy = dy <= resty ? true : false;
+        if (!crossx && !crossy) {
+            left += restx * signx;
+            top += resty * signy;
+            restx = 0;
+            resty = 0;
+            continue;
+        }
+
+        // 横の境界が先
+        if (crossx && (!crossy || dx * resty <= dy * restx)) {
+            if (resty > 0) {
+                int d = dx * resty / restx;
+                if (d >= dy) {
+                    d = dy - 1;
+                }
+                top += d * signy;
+                resty -= d;
+            }
+            int origin = left;
+            left += dx * signx;
+            restx -= dx;
+            int x = signx > 0 ? (left >> kFieldSweepShift) + width : (left >> kFieldSweepShift);
+            if (!FieldSweepColumn(x, top >> kFieldSweepShift, (top >> kFieldSweepShift) + height)) {
+                int tile = FieldFloorTile(x) * kFieldSizePixel;
+                left = signx > 0 ? (tile - 1 - width) << kFieldSweepShift : (tile + kFieldSizePixel) << kFieldSweepShift;
+                pendingx = retry ? 0 : restx + dx - abs(left - origin);
+                restx = 0;
+                sweep->normalX = -signx;
+            }
+
+        // 縦の境界が先
+        } else {
+            if (restx > 0) {
+                int d = dy * restx / resty;
+                if (d >= dx) {
+                    d = dx - 1;
+                }
+                left += d * signx;
+                restx -= d;
+            }
+            int origin = top;
+            top += dy * signy;
+            resty -= dy;
+            int y = signy > 0 ? (top >> kFieldSweepShift) + height : (top >> kFieldSweepShift);
+            if (!FieldSweepRow(y, left >> kFieldSweepShift, (left >> kFieldSweepShift) + width, signy > 0 && (flags & kFieldSweepFall) != 0)) {
+                int tile = FieldFloorTile(y) * kFieldSizePixel;
+                top = signy > 0 ? (tile - 1 - height) << kFieldSweepShift : (tile + kFieldSizePixel) << kFieldSweepShift;
+                pendingy = retry ? 0 : resty + dy - abs(top - origin);
+                resty = 0;
+                sweep->normalY = -signy;
+            }
+        }
+    }
+
+    // 矩形と端数の更新
+    int x = FieldAdjustX(left >> kFieldSweepShift);
+    rect->left = x;
+    rect->top = top >> kFieldSweepShift;
+    rect->right = x + width;
+    rect->bottom = rect->top + height;
+    fraction->x = left & kFieldSweepMask;
+    fraction->y = top & kFieldSweepMask;
+
+    // 足元と梯子の状態
+    sweep->ground = !FieldSweepRow(rect->bottom + 1, rect->left, rect->right, true);
+    int center = (rect->left + rect->right + 1) / 2;
+    sweep->ladder = FieldIsLadder(center, rect->top) || FieldIsLadder(center, rect->bottom) ? true : false;
+}
+static int FieldFloorTile(int pixel)
+{
+    return pixel >= 0 ? pixel / kFieldSizePixel : -((-pixel + kFieldSizePixel - 1) / kFieldSizePixel);
+}
+static bool FieldSweepColumn(int x, int top, int bottom)
+{
+    for (int y = FieldFloorTile(top); y <= FieldFloorTile(bottom); y++) {
+        if (!FieldIsSpace(x, y * kFieldSizePixel)) {
+            return false;
+        }
+    }
+    return true;
+}
+static bool FieldSweepRow(int y, int left, int right, bool fall)
+{
+    for (int x = FieldFloorTile(left); x <= FieldFloorTile(right); x++) {
+        if (fall ? !FieldIsFall(x * kFieldSizePixel, y) : !FieldIsSpace(x * kFieldSizePixel, y)) {
+            return false;
+        }
+    }
+    return true;
+}
+
 // 開始位置を取得する
 //
 void FieldGetStartPosition(struct Vector *position)
@@ -1110,8 +1560,8 @@ void FieldGetStartPosition(struct Vector *position)
 //
 void FieldGetEnemyPosition(struct Vector *position, bool land)
 {
-    int x = field->locations[field->locationEnemy].left + (IocsGetRandomNumber(&field->xorshift) % (field->locations[field->locationEnemy].right - field->locations[field->locationEnemy].left + 1));
-    int y = field->locations[field->locationEnemy].top + (IocsGetRandomNumber(&field->xorshift) % (field->locations[field->locationEnemy].bottom - field->locations[field->locationEnemy].top + 1));
+    int x = field->locations[field->locationEnemy].left + (IocsGetRandomNumber(&field->random) % (field->locations[field->locationEnemy].right - field->locations[field->locationEnemy].left + 1));
+    int y = field->locations[field->locationEnemy].top + (IocsGetRandomNumber(&field->random) % (field->locations[field->locationEnemy].bottom - field->locations[field->locationEnemy].top + 1));
     while (!FieldIsSpace(x * kFieldSizePixel, y * kFieldSizePixel)) {
         ++y;
         if (y > kFieldSizeY) {
@@ -1199,11 +1649,11 @@ int FieldGetShopIndex(int x, int y)
 //
 void FieldClearClip(void)
 {
-    IocsGetPlaydate()->graphics->clearClipRect();
+    IocsClearDrawClip();
 }
 void FieldSetClip(void)
 {
-    IocsGetPlaydate()->graphics->setClipRect(kGameViewFieldLeft, kGameViewFieldTop, kGameViewFieldSizeX, kGameViewFieldSizeY);
+    IocsSetDrawClip(kGameViewFieldLeft, kGameViewFieldTop, kGameViewFieldSizeX, kGameViewFieldSizeY);
 }
 
 
@@ -11,12 +11,19 @@
 #include "Aseprite.h"
 #include "Define.h"
 #include "Maze.h"
+#include "Path.h"
 
 
 // フィールド関数
 //
 typedef bool (*FieldIsFunction)(int x, int y);
 
+// 乱数
+//
+enum {
+    kFieldRandomSeed = 123456789, 
+};
+
 // 迷路
 //
 enum {
@@ -158,16 +165,66 @@ enum {
     kFieldShopSizeY = 3, 
 };
 
+// 作成
+//
+enum {
+    kFieldBuildLocation = 0, 
+    kFieldBuildMaze, 
+    kFieldBuildDig, 
+    kFieldBuildRoute, 
+    kFieldBuildSection, 
+    kFieldBuildBuilding, 
+    kFieldBuildDecoration, 
+    kFieldBuildCache, 
+    kFieldBuildDone, 
+    kFieldBuildDigStep = 64, 
+};
+
 // フィールド
 //
 struct Field {
 
     // 乱数
-    struct XorShift xorshift;
+    uint32_t seed;
+    struct IocsRandom random;
+
+    // 作成
+    int build;
+    int buildSection;
 
     // 迷路
     struct Maze *maze;
 
+    // 経路探索
+    struct Path *path;
+
+    // 中心
+    struct Vector os[kFieldMazeSizeY][kFieldMazeSizeX];
+
+    // マップ
+    unsigned char maps[kFieldSizeY][kFieldSizeX];
+
+    // 配置
+    struct Rect locations[kFieldLocationSize];
+    int locationEnemy;
+
+};
+
+// キャッシュ
+//
+enum {
+    kFieldCacheMagic = 0x5159414d, 
+};
+struct FieldCache {
+
+    // ヘッダ
+    uint32_t magic;
+    uint32_t version;
+    uint32_t seed;
+
+    // 乱数
+    struct IocsRandom random;
+
     // 中心
     struct Vector os[kFieldMazeSizeY][kFieldMazeSizeX];
 
@@ -178,6 +235,10 @@ struct Field {
     struct Rect locations[kFieldLocationSize];
     int locationEnemy;
 
+    // 迷路
+    unsigned char mazeMaps[(kFieldMazeSizeY * 2 + 1) * (kFieldMazeSizeX * 2 + 1)];
+    unsigned char mazeRoutes[kFieldMazeSizeY * kFieldMazeSizeX];
+
 };
 
 // アニメーション
@@ -246,6 +307,28 @@ enum {
     kFieldAnimationSize, 
 };
 
+// 掃引
+//
+enum {
+    kFieldSweepShift = 8, 
+    kFieldSweepOne = 0x0100, 
+    kFieldSweepMask = 0xff, 
+    kFieldSweepFall = 0x01, 
+};
+struct FieldSweep {
+
+    // 当たった面の向き（-1, 0, 1）
+    int normalX;
+    int normalY;
+
+    // 足元が床
+    bool ground;
+
+    // 梯子に重なる
+    bool ladder;
+
+};
+
 // アクタ
 //
 struct FieldActor {
@@ -260,10 +343,14 @@ struct FieldActor {
 
 // 外部参照関数
 //
-extern void FieldInitialize(void);
+extern void FieldInitialize(uint32_t seed);
+extern bool FieldBuild(int millisecond);
+extern int FieldGetBuildProgress(void);
+extern struct Field *FieldGetInstance(void);
 extern void FieldRelease(void);
 extern void FieldActorLoad(void);
 extern unsigned char FieldGetMap(int x, int y);
+extern int FieldFindPath(int fromx, int fromy, int tox, int toy, struct Vector *positions, int size);
 extern bool FieldIsSpace(int x, int y);
 extern bool FieldIsFall(int x, int y);
 extern bool FieldIsLadder(int x, int y);
@@ -272,6 +359,7 @@ extern bool FieldIsCastle(int x, int y);
 extern bool FieldIsShop(int x, int y);
 extern int FieldMove(int x, int y, int direction, int distance, FieldIsFunction is, struct Vector *to);
 extern int FieldMoveRect(struct Rect *from, int direction, int distance, FieldIsFunction is, struct Rect *to);
+extern void FieldSweepRect(struct Rect *rect, struct Vector *fraction, int movex, int movey, int flags, struct FieldSweep *sweep);
 extern void FieldGetStartPosition(struct Vector *position);
 extern void FieldGetEnemyPosition(struct Vector *position, bool land);
 extern int FieldGetCaveIndex(int x, int y);
@@ -12,12 +12,19 @@
 #include "Application.h"
 #include "Game.h"
 #include "Field.h"
+#include "Nav.h"
 #include "Player.h"
 #include "Enemy.h"
+#include "Hit.h"
+#include "Snapshot.h"
 
 // 内部関数
 //
 static void GameUnload(struct Game *game);
+static void GameInitializeField(void);
+static bool GamePrefetch(int millisecond);
+static void GameUnloadPrefetch(void);
+static bool GameBuildField(int millisecond);
 static void GameTransition(GameFunction function);
 static void GameLoadField(struct Game *game);
 static void GameStartField(struct Game *game);
@@ -25,6 +32,9 @@ static void GamePlayField(struct Game *game);
 static void GameUnloadField(struct Game *game);
 static void GameDone(struct Game *game);
 static void GameSetFieldCamera(void);
+static void GameLoadLoad(void);
+static void GameLoadDraw(struct GameLoad *load);
+static void GameLoadLoop(struct GameLoad *load);
 
 // 内部変数
 //
@@ -35,10 +45,18 @@ static const char *gameSpriteNames[] = {
     "skeleton", 
     "death", 
 };
+static const char *gameAudioBankName = "game";
 static const char *gameAudioSamplePaths[] = {
     "", 
 };
 static const char *gameAudioMusicPath = "";
+static const struct SceneManifest gameManifest = {
+    .spriteNames = gameSpriteNames, 
+    .spriteSize = sizeof (gameSpriteNames) / sizeof (char *), 
+    .prefetch = GamePrefetch, 
+    .unload = GameUnloadPrefetch, 
+};
+static bool gamePrefetchField = false;
 
 
 // ゲームを更新する
@@ -55,7 +73,7 @@ void GameUpdate(struct Game *game)
     if (game == NULL) {
 
         // ゲームの作成
-        game = playdate->system->realloc(NULL, sizeof (struct Game));
+        game = SceneAllocate(sizeof (struct Game));
         if (game == NULL) {
             playdate->system->error("%s: %d: game instance is not created.", __FILE__, __LINE__);
             return;
@@ -67,6 +85,9 @@ void GameUpdate(struct Game *game)
             // ユーザデータの設定
             SceneSetUserdata(game);
 
+            // 先読みしたフィールドの引き継ぎ
+            gamePrefetchField = false;
+
             // 解放の設定
             SceneSetUnload((SceneFunction)GameUnload);
 
@@ -80,20 +101,14 @@ void GameUpdate(struct Game *game)
             game->play = false;
         }
 
-        // スプライトの読み込み
+        // スプライトの読み込み（先読みされたスプライトはそのまま使う）
         AsepriteLoadSpriteList(gameSpriteNames, sizeof (gameSpriteNames) / sizeof (char *));
 
         // オーディオの読み込み
-        // IocsLoadAudioEffects(gameAudioSamplePaths, kGameAudioSampleSize);
-
-        // フィールドの初期化
-        FieldInitialize();
+        // IocsRetainAudioBank(gameAudioBankName, gameAudioSamplePaths, kGameAudioSampleSize, false);
 
-        // プレイヤの初期化
-        PlayerInitialize();
-
-        // エネミーの初期化
-        EnemyInitialize();
+        // フィールドとナビゲーションの初期化（先読みされていれば作成の続きから）
+        GameInitializeField();
 
         // 処理の設定
         GameTransition((GameFunction)GameLoadField);
@@ -112,12 +127,21 @@ static void GameUnload(struct Game *game)
     // アクタの解放
     ActorUnloadAll();
 
+    // スナップショットの解放
+    SnapshotRelease();
+
+    // 当たり判定の解放
+    HitRelease();
+
     // エネミーの解放
     EnemyRelease();
 
     // プレイヤの解放
     PlayerRelease();
 
+    // ナビゲーションの解放
+    NavRelease();
+
     // フィールドの解放
     FieldRelease();
 
@@ -125,8 +149,81 @@ static void GameUnload(struct Game *game)
     AsepriteUnloadAllSprites();
 
     // オーディオの解放
-    IocsUnloadAllAudioEffects();
+    IocsReleaseAudioBank(gameAudioBankName);
+
+}
+
+// フィールドとナビゲーションを初期化する
+//
+static void GameInitializeField(void)
+{
+    if (FieldGetInstance() == NULL) {
+
+        // フィールドの初期化
+        FieldInitialize(kFieldRandomSeed);
+
+        // ナビゲーションの初期化
+        NavInitialize();
+    }
+}
+
+// ゲームを先読みする
+//
+static bool GamePrefetch(int millisecond)
+{
+    // フィールドとナビゲーションの初期化（先読みで作成したことを覚えておく）
+    if (FieldGetInstance() == NULL) {
+        GameInitializeField();
+        gamePrefetchField = true;
+    }
+
+    // 作成を進める
+    return GameBuildField(millisecond);
+}
+
+// 先読みで作成したものを解放する
+//
+static void GameUnloadPrefetch(void)
+{
+    // 先読みで作成したフィールドとナビゲーションだけを解放する（スプライトはシーンが解放する）
+    if (gamePrefetchField) {
+        NavRelease();
+        FieldRelease();
+        gamePrefetchField = false;
+    }
+}
+
+// フィールドとナビゲーションの作成を進める（ナビゲーションにはフィールドの残りの時間だけを渡す）
+//
+static bool GameBuildField(int millisecond)
+{
+    // Playdate の取得
+    PlaydateAPI *playdate = IocsGetPlaydate();
+    if (playdate == NULL) {
+        return false;
+    }
+
+    // 0 以下なら最後まで作成する
+    if (millisecond <= 0) {
+        return FieldBuild(0) && NavBuild(0);
+    }
+
+    // フィールドの作成
+    unsigned int start = playdate->system->getCurrentTimeMilliseconds();
+    if (!FieldBuild(millisecond)) {
+        return false;
+    }
+
+    // ナビゲーションの作成（時間が残っていなければ次のフレームで始める）
+    int rest = millisecond - (int)(playdate->system->getCurrentTimeMilliseconds() - start);
+    return rest > 0 && NavBuild(rest);
+}
 
+// 先読みの内容を取得する
+//
+const struct SceneManifest *GameGetManifest(void)
+{
+    return &gameManifest;
 }
 
 // 処理を遷移する
@@ -156,24 +253,60 @@ static void GameLoadField(struct Game *game)
         // ゲームの停止
         game->play = false;
 
-        // フィールドアクタの読み込み
-        FieldActorLoad();
-
-        // プレイヤアクタの読み込み
-        PlayerActorLoad();
-
-        // エネミーアクタの読み込み
-        EnemyActorLoad();
+        // 読み込みアクタの読み込み
+        GameLoadLoad();
 
         // 初期化の完了
         ++game->state;
     }
 
-    // カメラの設定
-    GameSetFieldCamera();
+    // フィールドの作成
+    if (game->state == 1) {
+
+        // 1 フレームあたりの時間を決めて作成を進める（ナビゲーションはフィールドの完成後）
+        if (GameBuildField(kGameLoadMillisecond)) {
+
+            // プレイヤの初期化
+            PlayerInitialize();
+
+            // エネミーの初期化
+            EnemyInitialize();
+
+            // 当たり判定の初期化
+            HitInitialize();
+
+            // スナップショットの初期化
+            SnapshotInitialize();
+
+            // 読み込みアクタの解放
+            ActorUnloadWithTag(kGameTagLoad);
+
+            // フィールドアクタの読み込み
+            FieldActorLoad();
+
+            // プレイヤアクタの読み込み
+            PlayerActorLoad();
+
+            // エネミーアクタの読み込み
+            EnemyActorLoad();
+
+            // 当たり判定アクタの読み込み
+            HitActorLoad();
+
+            // 作成の完了
+            ++game->state;
+        }
+    }
 
     // 処理の遷移
-    GameTransition((GameFunction)GameStartField);
+    if (game->state == 2) {
+
+        // カメラの設定
+        GameSetFieldCamera();
+
+        // 処理の遷移
+        GameTransition((GameFunction)GameStartField);
+    }
 }
 
 // フィールドを開始する
@@ -229,6 +362,27 @@ static void GamePlayField(struct Game *game)
     // プレイの監視
     if (game->play) {
 
+        // スナップショットの記録（B を押しながら下で巻き戻し、上で保存、右で読み込み）
+#ifdef GAME_SNAPSHOT
+        if (IocsIsButtonPush(kButtonB) && IocsIsButtonPush(kButtonDown)) {
+            SnapshotRewind(1);
+        } else {
+            if (IocsIsButtonPush(kButtonB) && IocsIsButtonEdge(kButtonUp)) {
+                SnapshotSave();
+            } else if (IocsIsButtonPush(kButtonB) && IocsIsButtonEdge(kButtonRight)) {
+                SnapshotLoad();
+            }
+            SnapshotTake();
+        }
+#endif
+
+        // プレイヤへの追跡の更新
+        {
+            struct Vector position;
+            PlayerActorGetPosition(&position);
+            NavUpdateChase(position.x, position.y);
+        }
+
         // 洞窟に入る
         if (game->transition == NULL) {
             /*
@@ -392,9 +546,18 @@ void GameGetFieldCameraPosition(int x, int y, struct Vector *position)
     }
 }
 
+// カメラからのスプライトの位置を取得して、画面に入るかどうかを判定する
+//
+bool GameGetFieldSpritePosition(int x, int y, struct AsepriteSpriteAnimation *animation, float centerx, float centery, struct Vector *position)
+{
+    // X はフィールドが回り込むので、カメラに近い側の位置で判定する
+    GameGetFieldCameraPosition(x, y, position);
+    return AsepriteIsSpriteAnimationVisible(animation, position->x, position->y, centerx, centery);
+}
+
 // フィールド位置ので矩形を描画する
 //
-void GameDrawFieldRect(struct Rect *rect, LCDBitmapDrawMode drawmode, LCDColor color)
+void GameDrawFieldRect(struct Rect *rect, LCDColor color)
 {
     // Playdate の取得
     PlaydateAPI *playdate = IocsGetPlaydate();
@@ -406,7 +569,95 @@ void GameDrawFieldRect(struct Rect *rect, LCDBitmapDrawMode drawmode, LCDColor c
     {
         struct Vector view;
         GameGetFieldCameraPosition(rect->left, rect->top, &view);
-        playdate->graphics->setDrawMode(drawmode);
-        playdate->graphics->drawRect(view.x, view.y, rect->right - rect->left + 1, rect->bottom - rect->top + 1, color);
+        IocsDrawRect(view.x, view.y, rect->right - rect->left + 1, rect->bottom - rect->top + 1, color);
     }
 }
+
+// 読み込みアクタを読み込む
+//
+static void GameLoadLoad(void)
+{
+    // Playdate の取得
+    PlaydateAPI *playdate = IocsGetPlaydate();
+    if (playdate == NULL) {
+        return;
+    }
+
+    // アクタの確認
+    if (sizeof (struct GameLoad) > kActorBlockSize) {
+        playdate->system->error("%s: %d: load actor size is over: %d bytes.", __FILE__, __LINE__, sizeof (struct GameLoad));
+    }
+
+    // アクタの登録
+    struct GameLoad *load = (struct GameLoad *)ActorLoad((ActorFunction)GameLoadLoop, kGamePriorityLoad);
+    if (load == NULL) {
+        playdate->system->error("%s: %d: load actor is not loaded.", __FILE__, __LINE__);
+    }
+
+    // 読み込みの初期化
+    {
+        // タグの設定
+        ActorSetTag(&load->actor, kGameTagLoad);
+
+        // アニメーションの初期化
+        load->animation = 0;
+    }
+}
+
+// 読み込みアクタを描画する
+//
+static void GameLoadDraw(struct GameLoad *load)
+{
+    // Playdate の取得
+    PlaydateAPI *playdate = IocsGetPlaydate();
+    if (playdate == NULL) {
+        return;
+    }
+
+    // 文字列の描画
+    {
+        static const char *texts[] = {
+            "LOADING", 
+            "LOADING.", 
+            "LOADING..", 
+            "LOADING...", 
+        };
+        const char *text = texts[(load->animation / kGameLoadAnimationSpeed) % (sizeof (texts) / sizeof (texts[0]))];
+        int x = (kGameViewFieldSizeX - IocsGetTextWidth(kIocsFontSystem, texts[0])) / 2;
+        int y = kGameViewFieldSizeY / 2 - IocsGetFontHeight(kIocsFontSystem) - kGameLoadBarSizeY;
+        IocsDrawText(kIocsFontSystem, text, x, y, kDrawModeFillWhite);
+    }
+
+    // 進捗の描画
+    {
+        int x = (kGameViewFieldSizeX - kGameLoadBarSizeX) / 2;
+        int y = kGameViewFieldSizeY / 2;
+        int progress = (FieldGetBuildProgress() + NavGetBuildProgress()) / 2;
+        IocsDrawRect(x, y, kGameLoadBarSizeX, kGameLoadBarSizeY, kColorWhite);
+        IocsFillRect(x + 2, y + 2, (kGameLoadBarSizeX - 4) * progress / 100, kGameLoadBarSizeY - 4, kColorWhite);
+    }
+}
+
+// 読み込みアクタが待機する
+//
+static void GameLoadLoop(struct GameLoad *load)
+{
+    // Playdate の取得
+    PlaydateAPI *playdate = IocsGetPlaydate();
+    if (playdate == NULL) {
+        return;
+    }
+
+    // 初期化
+    if (load->actor.state == 0) {
+
+        // 初期化の完了
+        ++load->actor.state;
+    }
+
+    // アニメーションの更新
+    ++load->animation;
+
+    // 描画処理の設定
+    ActorSetDraw(&load->actor, (ActorFunction)GameLoadDraw, kGameOrderLoad);
+}
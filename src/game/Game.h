@@ -7,6 +7,9 @@
 #include <stdbool.h>
 #include "pd_api.h"
 #include "Define.h"
+#include "Aseprite.h"
+#include "Scene.h"
+#include "Actor.h"
 #include "Maze.h"
 
 
@@ -46,6 +49,24 @@ enum {
     kGameAudioSampleSize, 
 };
 
+// 読み込み
+//
+struct GameLoad {
+
+    // アクタ
+    struct Actor actor;
+
+    // アニメーション
+    int animation;
+
+};
+enum {
+    kGameLoadMillisecond = 20, 
+    kGameLoadBarSizeX = 160, 
+    kGameLoadBarSizeY = 8, 
+    kGameLoadAnimationSpeed = 8, 
+};
+
 // プライオリティ
 //
 enum {
@@ -53,6 +74,8 @@ enum {
     kGamePriorityField, 
     kGamePriorityPlayer, 
     kGamePriorityEnemy, 
+    kGamePriorityHit, 
+    kGamePriorityLoad, 
 };
 
 // タグ
@@ -62,6 +85,8 @@ enum {
     kGameTagField, 
     kGameTagPlayer, 
     kGameTagEnemy, 
+    kGameTagHit, 
+    kGameTagLoad, 
 };
 
 // 描画順
@@ -72,6 +97,7 @@ enum {
     kGameOrderEnemy, 
     kGameOrderPlayer, 
     kGameOrderCharacter, 
+    kGameOrderLoad, 
 };
 
 // カメラ
@@ -96,8 +122,10 @@ enum {
 // 外部参照関数
 //
 extern void GameUpdate(struct Game *game);
+extern const struct SceneManifest *GameGetManifest(void);
 extern bool GameIsPlay(void);
 extern struct Vector *GameGetCamera(void);
 extern void GameGetFieldCameraPosition(int x, int y, struct Vector *position);
-extern void GameDrawFieldRect(struct Rect *rect, LCDBitmapDrawMode drawmode, LCDColor color);
+extern bool GameGetFieldSpritePosition(int x, int y, struct AsepriteSpriteAnimation *animation, float centerx, float centery, struct Vector *position);
+extern void GameDrawFieldRect(struct Rect *rect, LCDColor color);
 
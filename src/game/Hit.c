@@ -0,0 +1,230 @@
+// Hit.c - 当たり判定
+//
+
+// 外部参照
+//
+#include <string.h>
+#include "pd_api.h"
+#include "Iocs.h"
+#include "Scene.h"
+#include "Actor.h"
+#include "Game.h"
+#include "Field.h"
+#include "Hit.h"
+
+// 内部関数
+//
+static void HitActorUnload(struct HitActor *actor);
+static void HitActorLoop(struct HitActor *actor);
+static void HitSweep(void);
+static void HitAddEntry(int rect, int left, int right, bool wrap);
+static void HitAddContact(const struct HitRect *a, const struct HitRect *b);
+
+// 内部変数
+//
+static struct Hit *hit = NULL;
+static const int hitContactTypes[kHitCategorySize][kHitCategorySize] = {
+    {kHitContactNull, kHitContactNull, kHitContactPlayerEnemy, }, 
+    {kHitContactNull, kHitContactNull, kHitContactAttackEnemy, }, 
+    {kHitContactPlayerEnemy, kHitContactAttackEnemy, kHitContactNull, }, 
+};
+
+
+// 当たり判定を初期化する
+//
+void HitInitialize(void)
+{
+    // Playdate の取得
+    PlaydateAPI *playdate = IocsGetPlaydate();
+    if (playdate == NULL) {
+        return;
+    }
+
+    // 当たり判定の作成
+    hit = (struct Hit *)SceneAllocate(sizeof (struct Hit));
+    if (hit == NULL) {
+        playdate->system->error("%s: %d: hit instance is not created.", __FILE__, __LINE__);
+    }
+    memset(hit, 0, sizeof (struct Hit));
+}
+
+// 当たり判定を解放する
+//
+void HitRelease(void)
+{
+    // Playdate の取得
+    PlaydateAPI *playdate = IocsGetPlaydate();
+    if (playdate == NULL) {
+        return;
+    }
+
+    // 当たり判定の解放（メモリはシーンのアリーナと一緒に解放される）
+    hit = NULL;
+}
+
+// 当たり判定インスタンスを取得する
+//
+struct Hit *HitGetInstance(void)
+{
+    return hit;
+}
+
+// 今回のフレームの矩形を登録する
+//
+void HitAddRect(int category, int owner, const struct Rect *rect)
+{
+    if (hit != NULL && hit->rectSize < kHitRectSize) {
+        struct HitRect *r = &hit->rects[hit->rectSize++];
+        r->category = category;
+        r->owner = owner;
+        r->rect = *rect;
+    }
+}
+
+// 前回の判定で見つかった接触を取得する
+//
+int HitGetContacts(int type, const struct HitContact **contacts)
+{
+    if (hit == NULL) {
+        *contacts = NULL;
+        return 0;
+    }
+    *contacts = hit->contacts[type];
+    return hit->contactSizes[type];
+}
+
+// 当たり判定アクタを読み込む
+//
+void HitActorLoad(void)
+{
+    // Playdate の取得
+    PlaydateAPI *playdate = IocsGetPlaydate();
+    if (playdate == NULL) {
+        return;
+    }
+
+    // アクタの確認
+    if (sizeof (struct HitActor) > kActorBlockSize) {
+        playdate->system->error("%s: %d: hit actor size is over: %d bytes.", __FILE__, __LINE__, sizeof (struct HitActor));
+    }
+
+    // アクタの登録
+    struct HitActor *actor = (struct HitActor *)ActorLoad((ActorFunction)HitActorLoop, kGamePriorityHit);
+    if (actor == NULL) {
+        playdate->system->error("%s: %d: hit actor is not loaded.", __FILE__, __LINE__);
+    }
+
+    // 当たり判定アクタの初期化
+    {
+        // 解放処理の設定
+        ActorSetUnload(&actor->actor, (ActorFunction)HitActorUnload);
+
+        // タグの設定
+        ActorSetTag(&actor->actor, kGameTagHit);
+    }
+}
+
+// 当たり判定アクタを解放する
+//
+static void HitActorUnload(struct HitActor *actor)
+{
+    // 矩形と接触の消去
+    if (hit != NULL) {
+        hit->rectSize = 0;
+        memset(hit->contactSizes, 0, sizeof (hit->contactSizes));
+    }
+}
+
+// 当たり判定アクタを処理する
+//
+static void HitActorLoop(struct HitActor *actor)
+{
+    // 接触の判定
+    HitSweep();
+
+    // 矩形の消去
+    hit->rectSize = 0;
+}
+
+// 矩形を横に並べて重なりを探す
+//
+static void HitSweep(void)
+{
+    // 接触の消去
+    memset(hit->contactSizes, 0, sizeof (hit->contactSizes));
+
+    // 項目の作成
+    hit->entrySize = 0;
+    for (int i = 0; i < hit->rectSize; i++) {
+        const struct Rect *rect = &hit->rects[i].rect;
+        int left = rect->left % (kFieldSizeX * kFieldSizePixel);
+        if (left < 0) {
+            left += kFieldSizeX * kFieldSizePixel;
+        }
+        int right = left + (rect->right - rect->left);
+        HitAddEntry(i, left, right, false);
+
+        // 右端をまたぐ矩形は左端にも置く
+        if (right >= kFieldSizeX * kFieldSizePixel) {
+            HitAddEntry(i, left - kFieldSizeX * kFieldSizePixel, right - kFieldSizeX * kFieldSizePixel, true);
+        }
+    }
+
+    // 左端で並べる
+    for (int i = 1; i < hit->entrySize; i++) {
+        struct HitEntry entry = hit->entries[i];
+        int j = i - 1;
+        while (j >= 0 && hit->entries[j].left > entry.left) {
+            hit->entries[j + 1] = hit->entries[j];
+            --j;
+        }
+        hit->entries[j + 1] = entry;
+    }
+
+    // 横に重なる範囲だけを調べる
+    for (int i = 0; i < hit->entrySize; i++) {
+        const struct HitEntry *e_0 = &hit->entries[i];
+        const struct HitRect *r_0 = &hit->rects[e_0->rect];
+        for (int j = i + 1; j < hit->entrySize && hit->entries[j].left <= e_0->right; j++) {
+            const struct HitEntry *e_1 = &hit->entries[j];
+            const struct HitRect *r_1 = &hit->rects[e_1->rect];
+            if (
+                !(e_0->wrap && e_1->wrap) && 
+                hitContactTypes[r_0->category][r_1->category] != kHitContactNull && 
+                r_0->rect.top <= r_1->rect.bottom && 
+                r_1->rect.top <= r_0->rect.bottom
+            ) {
+                HitAddContact(r_0, r_1);
+            }
+        }
+    }
+}
+
+// 項目を追加する
+//
+static void HitAddEntry(int rect, int left, int right, bool wrap)
+{
+    struct HitEntry *entry = &hit->entries[hit->entrySize++];
+    entry->rect = rect;
+    entry->left = left;
+    entry->right = right;
+    entry->wrap = wrap;
+}
+
+// 接触を追加する
+//
+static void HitAddContact(const struct HitRect *a, const struct HitRect *b)
+{
+    int type = hitContactTypes[a->category][b->category];
+    if (a->category == kHitCategoryEnemy) {
+        const struct HitRect *r = a;
+        a = b;
+        b = r;
+    }
+    if (hit->contactSizes[type] < kHitContactEntrySize) {
+        struct HitContact *contact = &hit->contacts[type][hit->contactSizes[type]++];
+        contact->type = type;
+        contact->owner = a->owner;
+        contact->other = b->owner;
+    }
+}
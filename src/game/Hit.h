@@ -0,0 +1,112 @@
+// Hit.h - 当たり判定
+//
+#pragma once
+
+// 外部参照
+//
+#include <stdbool.h>
+#include "pd_api.h"
+#include "Iocs.h"
+#include "Actor.h"
+#include "Define.h"
+
+
+// 種類
+//
+enum {
+    kHitCategoryPlayer = 0, 
+    kHitCategoryAttack, 
+    kHitCategoryEnemy, 
+    kHitCategorySize, 
+};
+
+// 接触
+//
+enum {
+    kHitContactNull = -1, 
+    kHitContactPlayerEnemy = 0, 
+    kHitContactAttackEnemy, 
+    kHitContactSize, 
+};
+struct HitContact {
+
+    // 種類
+    int type;
+
+    // 持ち主（プレイヤ側、エネミー側）
+    int owner;
+    int other;
+
+};
+
+// 矩形
+//
+enum {
+    kHitRectSize = 64, 
+    kHitEntrySize = kHitRectSize * 2, 
+    kHitContactEntrySize = 64, 
+};
+struct HitRect {
+
+    // 種類
+    int category;
+
+    // 持ち主
+    int owner;
+
+    // 矩形
+    struct Rect rect;
+
+};
+
+// 掃引の項目
+//
+struct HitEntry {
+
+    // 矩形
+    int rect;
+
+    // 左右の位置（横の折り返しを展開したもの）
+    int left;
+    int right;
+
+    // 折り返しの複製
+    bool wrap;
+
+};
+
+// 当たり判定
+//
+struct Hit {
+
+    // 矩形
+    struct HitRect rects[kHitRectSize];
+    int rectSize;
+
+    // 掃引の項目
+    struct HitEntry entries[kHitEntrySize];
+    int entrySize;
+
+    // 種類ごとの接触
+    struct HitContact contacts[kHitContactSize][kHitContactEntrySize];
+    int contactSizes[kHitContactSize];
+
+};
+
+// 当たり判定アクタ
+//
+struct HitActor {
+
+    // アクタ
+    struct Actor actor;
+
+};
+
+// 外部参照関数
+//
+extern void HitInitialize(void);
+extern void HitRelease(void);
+extern struct Hit *HitGetInstance(void);
+extern void HitAddRect(int category, int owner, const struct Rect *rect);
+extern int HitGetContacts(int type, const struct HitContact **contacts);
+extern void HitActorLoad(void);
@@ -6,6 +6,7 @@
 #include <string.h>
 #include "pd_api.h"
 #include "Iocs.h"
+#include "Scene.h"
 #include "Maze.h"
 
 // 内部関数
@@ -17,7 +18,7 @@
 
 // 迷路を初期化する
 //
-struct Maze *MazeLoad(int sizex, int sizey, struct XorShift *xorshift)
+struct Maze *MazeLoad(int sizex, int sizey, struct IocsRandom *random)
 {
     // Playdate の取得
     PlaydateAPI *playdate = IocsGetPlaydate();
@@ -26,18 +27,18 @@ struct Maze *MazeLoad(int sizex, int sizey, struct XorShift *xorshift)
     }
 
     // 迷路の作成
-    struct Maze *maze = (struct Maze *)playdate->system->realloc(NULL, sizeof (struct Maze));
+    struct Maze *maze = (struct Maze *)SceneAllocate(sizeof (struct Maze));
     if (maze == NULL) {
         playdate->system->error("%s: %d: maze is not created.", __FILE__, __LINE__);
     }
 
     // 乱数の設定
-    maze->xorshift = xorshift;
+    maze->random = random;
 
     // マップの作成
     maze->mapSize.x = sizex * 2 + 1;
     maze->mapSize.y = sizey * 2 + 1;
-    maze->maps = (unsigned char *)playdate->system->realloc(NULL, maze->mapSize.x * maze->mapSize.y * sizeof (unsigned char));
+    maze->maps = (unsigned char *)SceneAllocate(maze->mapSize.x * maze->mapSize.y * sizeof (unsigned char));
     if (maze->maps == NULL) {
         playdate->system->error("%s: %d: maze map is not created.", __FILE__, __LINE__);
     }
@@ -52,7 +53,7 @@ struct Maze *MazeLoad(int sizex, int sizey, struct XorShift *xorshift)
     // 経路の作成
     maze->routeSize.x = sizex;
     maze->routeSize.y = sizey;
-    maze->routes = (unsigned char *)playdate->system->realloc(NULL, maze->routeSize.x * maze->routeSize.y * sizeof (unsigned char));
+    maze->routes = (unsigned char *)SceneAllocate(maze->routeSize.x * maze->routeSize.y * sizeof (unsigned char));
     if (maze->routes == NULL) {
         playdate->system->error("%s: %d: maze route is not created.", __FILE__, __LINE__);
     }
@@ -64,6 +65,10 @@ struct Maze *MazeLoad(int sizex, int sizey, struct XorShift *xorshift)
         }
     }
 
+    // 穴掘りの初期化
+    maze->digs = NULL;
+    maze->digSize = 0;
+
     // 終了
     return maze;
 }
@@ -85,15 +90,12 @@ void MazeUnload(struct Maze *maze)
         return;
     }
 
-    // 迷路の解放
+    // 迷路の解放（マップと経路はシーンのアリーナと一緒に解放される）
     if (maze != NULL) {
-        if (maze->routes != NULL) {
-            playdate->system->realloc(maze->routes, 0);
-        }
-        if (maze->maps != NULL) {
-            playdate->system->realloc(maze->maps, 0);
+        if (maze->digs != NULL) {
+            IocsRealloc(kIocsMemoryTagMaze, maze->digs, 0);
+            maze->digs = NULL;
         }
-        playdate->system->realloc(maze, 0);
     }
 }
 
@@ -101,71 +103,121 @@ void MazeUnload(struct Maze *maze)
 //
 void MazeDig(struct Maze *maze, int x, int y)
 {
-    // 方向の初期化
-    int up = 0;
-    int down = 0;
-    int left = 0;
-    int right = 0;
+    MazeDigBegin(maze, x, y);
+    while (!MazeDigStep(maze, maze->routeSize.x * maze->routeSize.y)) {
+        ;
+    }
+}
 
-    // 全方向に掘る
-    while (up == 0 || down == 0 || left == 0 || right == 0) {
+// 穴掘りを開始する
+//
+void MazeDigBegin(struct Maze *maze, int x, int y)
+{
+    // Playdate の取得
+    PlaydateAPI *playdate = IocsGetPlaydate();
+    if (playdate == NULL) {
+        return;
+    }
+
+    // スタックの作成
+    if (maze->digs == NULL) {
+        maze->digs = (struct MazeDigFrame *)IocsRealloc(kIocsMemoryTagMaze, NULL, maze->routeSize.x * maze->routeSize.y * sizeof (struct MazeDigFrame));
+        if (maze->digs == NULL) {
+            playdate->system->error("%s: %d: maze dig stack is not created.", __FILE__, __LINE__);
+            return;
+        }
+    }
+
+    // 開始位置の設定
+    maze->digs[0].x = x;
+    maze->digs[0].y = y;
+    maze->digs[0].up = 0;
+    maze->digs[0].down = 0;
+    maze->digs[0].left = 0;
+    maze->digs[0].right = 0;
+    maze->digSize = 1;
+}
+
+// 穴掘りを指定された回数だけ進める
+//
+bool MazeDigStep(struct Maze *maze, int count)
+{
+    // 再帰の代わりにスタックで掘り進める（乱数の消費順は再帰と同じ）
+    while (maze->digSize > 0 && count-- > 0) {
+
+        // 方向の取得
+        struct MazeDigFrame *dig = &maze->digs[maze->digSize - 1];
+        int x = dig->x;
+        int y = dig->y;
+
+        // 全方向に掘り終えた
+        if (dig->up != 0 && dig->down != 0 && dig->left != 0 && dig->right != 0) {
+            --maze->digSize;
+            continue;
+        }
 
         // ランダムに方向を選択
-        int d = IocsGetRandomNumber(maze->xorshift) & 0x03;
+        int d = IocsGetRandomNumber(maze->random) & 0x03;
+        int dx = 0;
+        int dy = 0;
 
         // 上に掘る
         if (d == 0) {
             if (y >= 2) {
-                int y_2 = y - 2;
-                int y_1 = y - 1;
-                if (maze->maps[y_2 * maze->mapSize.x + x] == kMazeMapBlock) {
-                    maze->maps[y_2 * maze->mapSize.x + x] = kMazeMapNull;
-                    maze->maps[y_1 * maze->mapSize.x + x] = kMazeMapNull;
-                    MazeDig(maze, x, y_2);
-                }
+                dy = -2;
             }
-            ++up;
+            ++dig->up;
 
         // 下に掘る
         } else if (d == 1) {
             if (y < maze->mapSize.y - 2) {
-                int y_2 = y + 2;
-                int y_1 = y + 1;
-                if (maze->maps[y_2 * maze->mapSize.x + x] == kMazeMapBlock) {
-                    maze->maps[y_2 * maze->mapSize.x + x] = kMazeMapNull;
-                    maze->maps[y_1 * maze->mapSize.x + x] = kMazeMapNull;
-                    MazeDig(maze, x, y_2);
-                }
+                dy = 2;
             }
-            ++down;
+            ++dig->down;
 
         // 左に掘る
         } else if (d == 2) {
             if (x >= 2) {
-                int x_2 = x - 2;
-                int x_1 = x - 1;
-                if (maze->maps[y * maze->mapSize.x + x_2] == kMazeMapBlock) {
-                    maze->maps[y * maze->mapSize.x + x_2] = kMazeMapNull;
-                    maze->maps[y * maze->mapSize.x + x_1] = kMazeMapNull;
-                    MazeDig(maze, x_2, y);
-                }
+                dx = -2;
             }
-            ++left;
+            ++dig->left;
 
         // 右に掘る
         } else {
             if (x < maze->mapSize.x - 2) {
-                int x_2 = x + 2;
-                int x_1 = x + 1;
-                if (maze->maps[y * maze->mapSize.x + x_2] == kMazeMapBlock) {
-                    maze->maps[y * maze->mapSize.x + x_2] = kMazeMapNull;
-                    maze->maps[y * maze->mapSize.x + x_1] = kMazeMapNull;
-                    MazeDig(maze, x_2, y);
-                }
+                dx = 2;
+            }
+            ++dig->right;
+        }
+
+        // 掘り進める
+        if (dx != 0 || dy != 0) {
+            int x_2 = x + dx;
+            int y_2 = y + dy;
+            int x_1 = x + dx / 2;
+            int y_1 = y + dy / 2;
+            if (maze->maps[y_2 * maze->mapSize.x + x_2] == kMazeMapBlock) {
+                maze->maps[y_2 * maze->mapSize.x + x_2] = kMazeMapNull;
+                maze->maps[y_1 * maze->mapSize.x + x_1] = kMazeMapNull;
+                struct MazeDigFrame *next = &maze->digs[maze->digSize++];
+                next->x = x_2;
+                next->y = y_2;
+                next->up = 0;
+                next->down = 0;
+                next->left = 0;
+                next->right = 0;
             }
-            ++right;
         }
     }
+
+    // スタックの解放
+    if (maze->digSize == 0 && maze->digs != NULL) {
+        IocsRealloc(kIocsMemoryTagMaze, maze->digs, 0);
+        maze->digs = NULL;
+    }
+
+    // 終了
+    return maze->digSize == 0 ? true : false;
 }
 
 // 経路を設定する
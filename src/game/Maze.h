@@ -28,6 +28,17 @@ enum {
     kMazeRouteRight = 0x08, 
 };
 
+// 穴掘り
+//
+struct MazeDigFrame {
+    int x;
+    int y;
+    int up;
+    int down;
+    int left;
+    int right;
+};
+
 // 迷路
 //
 struct Maze {
@@ -40,16 +51,22 @@ struct Maze {
     unsigned char *routes;
     struct Vector routeSize;
 
+    // 穴掘り
+    struct MazeDigFrame *digs;
+    int digSize;
+
     // 乱数
-    struct XorShift *xorshift;
+    struct IocsRandom *random;
 
 };
 
 // 外部参照関数
 //
-extern struct Maze *MazeLoad(int sizex, int sizey, struct XorShift *xorshift);
+extern struct Maze *MazeLoad(int sizex, int sizey, struct IocsRandom *random);
 extern void MazeUnload(struct Maze *maze);
 extern void MazeLock(struct Maze *maze, int x, int y);
 extern void MazeDig(struct Maze *maze, int x, int y);
+extern void MazeDigBegin(struct Maze *maze, int x, int y);
+extern bool MazeDigStep(struct Maze *maze, int count);
 extern void MazeSetRoute(struct Maze *maze);
 extern void MazeSolveDeadend(struct Maze *maze);
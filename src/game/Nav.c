@@ -0,0 +1,636 @@
+// Nav.c - ナビゲーション
+//
+
+// 外部参照
+//
+#include <string.h>
+#include "pd_api.h"
+#include "Iocs.h"
+#include "Scene.h"
+#include "Game.h"
+#include "Field.h"
+#include "Player.h"
+#include "Nav.h"
+
+// 内部関数
+//
+static void NavBuildNode(void);
+static void NavBuildJump(struct NavJump *jump, int direction, int delay, bool boost);
+static void NavBuildEdge(int y);
+static void NavBuildReverse(void);
+static int NavAddEdge(struct NavEdge *edges, int size, int node, int type, int cost);
+static int NavGetFallCost(int distance);
+static int NavFloor(int pixel);
+static int NavWrapX(int x);
+static unsigned char NavGetAttribute(int x, int y);
+static void NavPushHeap(int node, int cost);
+static struct NavHeap NavPopHeap(void);
+
+// 内部変数
+//
+static struct Nav *nav = NULL;
+
+
+// ナビゲーションを初期化する
+//
+void NavInitialize(void)
+{
+    // Playdate の取得
+    PlaydateAPI *playdate = IocsGetPlaydate();
+    if (playdate == NULL) {
+        return;
+    }
+
+    // ナビゲーションの作成
+    nav = (struct Nav *)SceneAllocate(sizeof (struct Nav));
+    if (nav == NULL) {
+        playdate->system->error("%s: %d: nav instance is not created.", __FILE__, __LINE__);
+    }
+    memset(nav, 0, sizeof (struct Nav));
+
+    // ナビゲーションの初期化
+    {
+        // 作成の開始
+        nav->build = kNavBuildNode;
+        nav->buildRow = 0;
+
+        // 追跡の初期化
+        nav->chaseNode = kNavNodeNull;
+        nav->chaseTarget = kNavNodeNull;
+        nav->chaseBusy = false;
+    }
+}
+
+// ナビゲーションを解放する
+//
+void NavRelease(void)
+{
+    // Playdate の取得
+    PlaydateAPI *playdate = IocsGetPlaydate();
+    if (playdate == NULL) {
+        return;
+    }
+
+    // ナビゲーションの解放（本体はシーンのアリーナと一緒に解放される）
+    if (nav != NULL) {
+        void *blocks[] = {
+            nav->nodeTiles,
+            nav->edgeStarts,
+            nav->edges,
+            nav->reverseStarts,
+            nav->reverses,
+            nav->chaseCosts,
+            nav->chaseWrites,
+            nav->chaseHeaps,
+        };
+        for (int i = 0; i < (int)(sizeof (blocks) / sizeof (blocks[0])); i++) {
+            if (blocks[i] != NULL) {
+                IocsRealloc(kIocsMemoryTagNav, blocks[i], 0);
+            }
+        }
+        nav = NULL;
+    }
+}
+
+// ナビゲーションを作成する
+//
+bool NavBuild(int millisecond)
+{
+    // Playdate の取得
+    PlaydateAPI *playdate = IocsGetPlaydate();
+    if (playdate == NULL || nav == NULL) {
+        return false;
+    }
+
+    // 時間の計測の開始（0 以下なら最後まで作成する）
+    unsigned int start = millisecond > 0 ? playdate->system->getCurrentTimeMilliseconds() : 0;
+
+    // 作成の再開
+    while (nav->build != kNavBuildDone) {
+
+        // 節点と軌跡の作成
+        if (nav->build == kNavBuildNode) {
+            NavBuildNode();
+            nav->buildRow = 0;
+            ++nav->build;
+
+        // 1 行ずつ辺を作成する
+        } else if (nav->build == kNavBuildEdge) {
+            NavBuildEdge(nav->buildRow);
+            if (++nav->buildRow >= kFieldSizeY) {
+                nav->edgeStarts[nav->nodeSize] = nav->edgeSize;
+                ++nav->build;
+            }
+
+        // 逆向きの辺の作成
+        } else if (nav->build == kNavBuildReverse) {
+            NavBuildReverse();
+            ++nav->build;
+        }
+
+        // 時間の確認
+        if (millisecond > 0 && (int)(playdate->system->getCurrentTimeMilliseconds() - start) >= millisecond) {
+            break;
+        }
+    }
+
+    // 終了
+    return nav->build == kNavBuildDone ? true : false;
+}
+
+// ナビゲーションの作成の進捗を取得する
+//
+int NavGetBuildProgress(void)
+{
+    int progress = 0;
+    if (nav != NULL) {
+        if (nav->build == kNavBuildEdge) {
+            progress = nav->buildRow * 100 / kFieldSizeY;
+        } else if (nav->build > kNavBuildEdge) {
+            progress = 100;
+        }
+    }
+    return progress;
+}
+
+// 節点を作成する
+//
+static void NavBuildNode(void)
+{
+    // Playdate の取得
+    PlaydateAPI *playdate = IocsGetPlaydate();
+    if (playdate == NULL) {
+        return;
+    }
+
+    // タイルの属性を求める
+    for (int y = 0; y < kFieldSizeY; y++) {
+        for (int x = 0; x < kFieldSizeX; x++) {
+            int px = x * kFieldSizePixel;
+            int py = y * kFieldSizePixel;
+            unsigned char attribute = 0;
+            if (FieldIsSpace(px, py)) {
+                attribute |= kNavAttributeSpace;
+                if (!FieldIsFall(px, py + kFieldSizePixel)) {
+                    attribute |= kNavAttributeStand;
+                }
+            }
+            if (FieldIsFall(px, py)) {
+                attribute |= kNavAttributeFall;
+            }
+            if (FieldIsLadder(px, py)) {
+                attribute |= kNavAttributeLadder;
+            }
+            nav->attributes[y][x] = attribute;
+        }
+    }
+
+    // 立てる位置と梯子を節点にする
+    nav->nodeSize = 0;
+    for (int y = 0; y < kFieldSizeY; y++) {
+        for (int x = 0; x < kFieldSizeX; x++) {
+            if ((nav->attributes[y][x] & (kNavAttributeStand | kNavAttributeLadder)) != 0) {
+                nav->tileNodes[y][x] = (short)nav->nodeSize++;
+            } else {
+                nav->tileNodes[y][x] = kNavNodeNull;
+            }
+        }
+    }
+    nav->nodeTiles = (unsigned short *)IocsRealloc(kIocsMemoryTagNav, NULL, (nav->nodeSize + 1) * sizeof (unsigned short));
+    nav->edgeStarts = (int *)IocsRealloc(kIocsMemoryTagNav, NULL, (nav->nodeSize + 1) * sizeof (int));
+    if (nav->nodeTiles == NULL || nav->edgeStarts == NULL) {
+        playdate->system->error("%s: %d: nav node is not created.", __FILE__, __LINE__);
+    }
+    for (int y = 0; y < kFieldSizeY; y++) {
+        for (int x = 0; x < kFieldSizeX; x++) {
+            if (nav->tileNodes[y][x] != kNavNodeNull) {
+                nav->nodeTiles[nav->tileNodes[y][x]] = (unsigned short)(y * kFieldSizeX + x);
+            }
+        }
+    }
+
+    // ジャンプの軌跡を作る（その場、左右へすぐ、左右へ頂点付近から × 1 段、2 段）
+    {
+        static const int directions[] = {0, -1, 1, -1, 1, };
+        static const int delays[] = {0, 0, 0, kNavJumpDelay, kNavJumpDelay, };
+        for (int i = 0; i < (int)(sizeof (directions) / sizeof (directions[0])); i++) {
+            for (int boost = 0; boost < kNavJumpBoostSize; boost++) {
+                NavBuildJump(&nav->jumps[i * kNavJumpBoostSize + boost], directions[i], delays[i], boost > 0 ? true : false);
+            }
+        }
+    }
+    nav->edgeSize = 0;
+}
+
+// ジャンプの軌跡を作る
+//
+static void NavBuildJump(struct NavJump *jump, int direction, int delay, bool boost)
+{
+    // プレイヤアクタと同じ規則で、タイルの中心の足元から跳ぶ
+    int xs[kNavJumpFrameSize + 1];
+    int ys[kNavJumpFrameSize + 1];
+    int x = kFieldSizePixel / 2;
+    int y = kFieldSizePixel - 1;
+    int vx = 0;
+    int vy = -kPlayerMoveJumpStart;
+    bool boosted = false;
+    int size = 0;
+    while (size <= kNavJumpFrameSize) {
+
+        // 2 段目のジャンプは頂点で行う
+        if (size > 0) {
+            if (boost && !boosted && vy >= 0) {
+                vy = -kPlayerMoveJumpBoost;
+                boosted = true;
+            }
+            if (vy < 0) {
+                vy += kPlayerMoveGravity;
+            } else {
+                vy += kPlayerMoveGravity;
+                if (vy > kPlayerMoveFallMaximum) {
+                    vy = kPlayerMoveFallMaximum;
+                }
+            }
+        }
+
+        // 左右の加速（遅らせると段差の上に乗れる）
+        if (size >= delay) {
+            vx += direction * kPlayerMoveWalkAccel;
+        }
+        if (vx < -kPlayerMoveWalkMaximum) {
+            vx = -kPlayerMoveWalkMaximum;
+        } else if (vx > kPlayerMoveWalkMaximum) {
+            vx = kPlayerMoveWalkMaximum;
+        }
+
+        // 移動
+        x += vx >> kPlayerMoveShift;
+        y += vy >> kPlayerMoveShift;
+        xs[size] = x;
+        ys[size] = y;
+        ++size;
+    }
+
+    // フレームごとに重なるタイルを記録する
+    jump->frameSize = kNavJumpFrameSize;
+    for (int i = 0; i < kNavJumpFrameSize; i++) {
+        struct NavJumpFrame *frame = &jump->frames[i];
+        frame->center = (signed char)NavFloor(xs[i]);
+        frame->left = (signed char)NavFloor(xs[i] - 7);
+        frame->right = (signed char)NavFloor(xs[i] + 6);
+        frame->top = (signed char)NavFloor(ys[i] - 23);
+        frame->bottom = (signed char)NavFloor(ys[i]);
+        frame->land = NavFloor(ys[i + 1]) > NavFloor(ys[i]) ? true : false;
+    }
+}
+
+// 1 行分の辺を作成する
+//
+static void NavBuildEdge(int y)
+{
+    // Playdate の取得
+    PlaydateAPI *playdate = IocsGetPlaydate();
+    if (playdate == NULL) {
+        return;
+    }
+
+    for (int x = 0; x < kFieldSizeX; x++) {
+        int node = nav->tileNodes[y][x];
+        if (node == kNavNodeNull) {
+            continue;
+        }
+        unsigned char attribute = nav->attributes[y][x];
+        struct NavEdge edges[kDirectionSize * 2 + kNavJumpSize];
+        int size = 0;
+
+        // 歩く、落ちる
+        if ((attribute & kNavAttributeStand) != 0) {
+            for (int dx = -1; dx <= 1; dx += 2) {
+                int nx = NavWrapX(x + dx);
+                unsigned char next = nav->attributes[y][nx];
+                if ((next & kNavAttributeStand) != 0) {
+                    size = NavAddEdge(edges, size, nav->tileNodes[y][nx], kNavEdgeWalk, kNavCostWalk);
+                } else if ((next & kNavAttributeSpace) != 0) {
+                    int ny = y + 1;
+                    while (ny < kFieldSizeY && (nav->attributes[ny][nx] & kNavAttributeStand) == 0 && (nav->attributes[ny][nx] & kNavAttributeFall) != 0) {
+                        ++ny;
+                    }
+                    if (ny < kFieldSizeY && (nav->attributes[ny][nx] & kNavAttributeStand) != 0) {
+                        size = NavAddEdge(edges, size, nav->tileNodes[ny][nx], kNavEdgeFall, kNavCostWalk + NavGetFallCost((ny - y) * kFieldSizePixel));
+                    }
+                }
+            }
+        }
+
+        // 梯子を上り下りする
+        if ((attribute & kNavAttributeLadder) != 0 && y > 0 && nav->tileNodes[y - 1][x] != kNavNodeNull) {
+            size = NavAddEdge(edges, size, nav->tileNodes[y - 1][x], kNavEdgeClimb, kNavCostClimb);
+        }
+        if (y < kFieldSizeY - 1 && (nav->attributes[y + 1][x] & kNavAttributeLadder) != 0) {
+            size = NavAddEdge(edges, size, nav->tileNodes[y + 1][x], kNavEdgeClimb, kNavCostClimb);
+        }
+
+        // 跳ぶ（軌跡が壁や天井に当たったら、その軌跡は使わない）
+        if ((attribute & kNavAttributeStand) != 0) {
+            for (int i = 0; i < kNavJumpSize; i++) {
+                const struct NavJump *jump = &nav->jumps[i];
+                for (int f = 0; f < jump->frameSize; f++) {
+                    const struct NavJumpFrame *frame = &jump->frames[f];
+                    bool hit = false;
+                    for (int ty = frame->top; ty <= frame->bottom && !hit; ty++) {
+                        for (int tx = frame->left; tx <= frame->right && !hit; tx++) {
+                            if ((NavGetAttribute(x + tx, y + ty) & kNavAttributeSpace) == 0) {
+                                hit = true;
+                            }
+                        }
+                    }
+                    if (hit) {
+                        break;
+                    }
+                    if (frame->land) {
+                        int ly = y + frame->bottom;
+                        bool ground = false;
+                        for (int tx = frame->left; tx <= frame->right; tx++) {
+                            if ((NavGetAttribute(x + tx, ly + 1) & kNavAttributeFall) == 0) {
+                                ground = true;
+                            }
+                        }
+                        if (ground) {
+                            int lx = NavWrapX(x + frame->center);
+                            for (int tx = frame->left; tx <= frame->right && (nav->attributes[ly][lx] & kNavAttributeStand) == 0; tx++) {
+                                lx = NavWrapX(x + tx);
+                            }
+                            if ((nav->attributes[ly][lx] & kNavAttributeStand) != 0 && nav->tileNodes[ly][lx] != node) {
+                                size = NavAddEdge(edges, size, nav->tileNodes[ly][lx], kNavEdgeJump, f + 1);
+                            }
+                            break;
+                        }
+                    }
+                }
+            }
+        }
+
+        // CSR に追加する
+        if (nav->edgeSize + size > nav->edgeCapacity) {
+            nav->edgeCapacity = nav->edgeCapacity > 0 ? nav->edgeCapacity * 2 : 4096;
+            nav->edges = (struct NavEdge *)IocsRealloc(kIocsMemoryTagNav, nav->edges, nav->edgeCapacity * sizeof (struct NavEdge));
+            if (nav->edges == NULL) {
+                playdate->system->error("%s: %d: nav edge is not created.", __FILE__, __LINE__);
+            }
+        }
+        nav->edgeStarts[node] = nav->edgeSize;
+        memcpy(&nav->edges[nav->edgeSize], edges, size * sizeof (struct NavEdge));
+        nav->edgeSize += size;
+    }
+}
+
+// 逆向きの辺を作成する
+//
+static void NavBuildReverse(void)
+{
+    // Playdate の取得
+    PlaydateAPI *playdate = IocsGetPlaydate();
+    if (playdate == NULL) {
+        return;
+    }
+
+    // 逆向きの辺と追跡用の領域の作成
+    nav->reverseStarts = (int *)IocsRealloc(kIocsMemoryTagNav, NULL, (nav->nodeSize + 1) * sizeof (int));
+    nav->reverses = (struct NavEdge *)IocsRealloc(kIocsMemoryTagNav, NULL, (nav->edgeSize + 1) * sizeof (struct NavEdge));
+    nav->chaseCosts = (int *)IocsRealloc(kIocsMemoryTagNav, NULL, (nav->nodeSize + 1) * sizeof (int));
+    nav->chaseWrites = (int *)IocsRealloc(kIocsMemoryTagNav, NULL, (nav->nodeSize + 1) * sizeof (int));
+    nav->chaseHeaps = (struct NavHeap *)IocsRealloc(kIocsMemoryTagNav, NULL, (nav->edgeSize + 1) * sizeof (struct NavHeap));
+    if (nav->reverseStarts == NULL || nav->reverses == NULL || nav->chaseCosts == NULL || nav->chaseWrites == NULL || nav->chaseHeaps == NULL) {
+        playdate->system->error("%s: %d: nav reverse edge is not created.", __FILE__, __LINE__);
+    }
+
+    // 行き先ごとに数えて並べる
+    memset(nav->reverseStarts, 0, (nav->nodeSize + 1) * sizeof (int));
+    for (int i = 0; i < nav->edgeSize; i++) {
+        ++nav->reverseStarts[nav->edges[i].node + 1];
+    }
+    for (int i = 0; i < nav->nodeSize; i++) {
+        nav->reverseStarts[i + 1] += nav->reverseStarts[i];
+    }
+    for (int i = 0; i < nav->nodeSize; i++) {
+        nav->chaseCosts[i] = nav->reverseStarts[i];
+    }
+    for (int node = 0; node < nav->nodeSize; node++) {
+        for (int i = nav->edgeStarts[node]; i < nav->edgeStarts[node + 1]; i++) {
+            struct NavEdge *reverse = &nav->reverses[nav->chaseCosts[nav->edges[i].node]++];
+            *reverse = nav->edges[i];
+            reverse->node = (unsigned short)node;
+        }
+    }
+    for (int i = 0; i < nav->nodeSize; i++) {
+        nav->chaseCosts[i] = kNavCostNull;
+    }
+    nav->chaseNode = kNavNodeNull;
+    nav->chaseTarget = kNavNodeNull;
+    nav->chaseBusy = false;
+}
+
+// 辺を追加する（同じ行き先なら安い方を残す）
+//
+static int NavAddEdge(struct NavEdge *edges, int size, int node, int type, int cost)
+{
+    if (cost > kNavCostMaximum) {
+        cost = kNavCostMaximum;
+    }
+    for (int i = 0; i < size; i++) {
+        if (edges[i].node == node) {
+            if (cost < edges[i].cost) {
+                edges[i].type = (unsigned char)type;
+                edges[i].cost = (unsigned char)cost;
+            }
+            return size;
+        }
+    }
+    edges[size].node = (unsigned short)node;
+    edges[size].type = (unsigned char)type;
+    edges[size].cost = (unsigned char)cost;
+    return size + 1;
+}
+
+// 落下にかかるフレーム数を取得する
+//
+static int NavGetFallCost(int distance)
+{
+    int result = 0;
+    int vy = kPlayerMoveFallStart;
+    while (distance > 0) {
+        distance -= vy >> kPlayerMoveShift;
+        vy += kPlayerMoveGravity;
+        if (vy > kPlayerMoveFallMaximum) {
+            vy = kPlayerMoveFallMaximum;
+        }
+        ++result;
+    }
+    return result;
+}
+
+// 位置を補正する
+//
+static int NavFloor(int pixel)
+{
+    return pixel >= 0 ? pixel / kFieldSizePixel : -((-pixel + kFieldSizePixel - 1) / kFieldSizePixel);
+}
+static int NavWrapX(int x)
+{
+    while (x < 0) {
+        x += kFieldSizeX;
+    }
+    while (x >= kFieldSizeX) {
+        x -= kFieldSizeX;
+    }
+    return x;
+}
+
+// 属性を取得する（上下の範囲外はブロック）
+//
+static unsigned char NavGetAttribute(int x, int y)
+{
+    return y >= 0 && y < kFieldSizeY ? nav->attributes[y][NavWrapX(x)] : 0;
+}
+
+// 節点を取得する
+//
+int NavGetNode(int x, int y)
+{
+    int result = kNavNodeNull;
+    if (nav != NULL && nav->build == kNavBuildDone) {
+        if (y >= 0 && y < kFieldSizeY * kFieldSizePixel) {
+            result = nav->tileNodes[y / kFieldSizePixel][NavWrapX(NavFloor(x))];
+        }
+    }
+    return result;
+}
+
+// 節点から出る辺を取得する
+//
+int NavGetEdges(int node, const struct NavEdge **edges)
+{
+    int result = 0;
+    if (nav != NULL && nav->build == kNavBuildDone && node >= 0 && node < nav->nodeSize) {
+        *edges = &nav->edges[nav->edgeStarts[node]];
+        result = nav->edgeStarts[node + 1] - nav->edgeStarts[node];
+    }
+    return result;
+}
+
+// 節点の位置を取得する（タイルの中心の足元）
+//
+void NavGetNodePosition(int node, struct Vector *position)
+{
+    if (nav != NULL && node >= 0 && node < nav->nodeSize) {
+        position->x = (nav->nodeTiles[node] % kFieldSizeX) * kFieldSizePixel + kFieldSizePixel / 2;
+        position->y = (nav->nodeTiles[node] / kFieldSizeX) * kFieldSizePixel + kFieldSizePixel - 1;
+    }
+}
+
+// 追跡する目標を更新する（1 フレームに kNavChaseStep 個の節点まで求める）
+//
+void NavUpdateChase(int x, int y)
+{
+    // ナビゲーションの確認
+    if (nav == NULL || nav->build != kNavBuildDone) {
+        return;
+    }
+
+    // 計算中でなく目標の節点が変わっていれば計算を開始する（空中にいる間は前の目標を使う）
+    if (!nav->chaseBusy) {
+        int target = NavGetNode(x, y);
+        if (target == kNavNodeNull || target == nav->chaseNode) {
+            return;
+        }
+        for (int i = 0; i < nav->nodeSize; i++) {
+            nav->chaseWrites[i] = kNavCostNull;
+        }
+        nav->chaseTarget = target;
+        nav->chaseHeapSize = 0;
+        nav->chaseWrites[target] = 0;
+        NavPushHeap(target, 0);
+        nav->chaseBusy = true;
+    }
+
+    // 逆向きの辺で目標までのコストを Dijkstra で求める
+    for (int step = 0; step < kNavChaseStep && nav->chaseHeapSize > 0; step++) {
+        struct NavHeap heap = NavPopHeap();
+        if (heap.cost > nav->chaseWrites[heap.node]) {
+            continue;
+        }
+        for (int i = nav->reverseStarts[heap.node]; i < nav->reverseStarts[heap.node + 1]; i++) {
+            const struct NavEdge *reverse = &nav->reverses[i];
+            int cost = heap.cost + reverse->cost;
+            if (cost < nav->chaseWrites[reverse->node]) {
+                nav->chaseWrites[reverse->node] = cost;
+                NavPushHeap(reverse->node, cost);
+            }
+        }
+    }
+
+    // 求め終わったら読み込み側と入れ替える
+    if (nav->chaseHeapSize == 0) {
+        int *costs = nav->chaseCosts;
+        nav->chaseCosts = nav->chaseWrites;
+        nav->chaseWrites = costs;
+        nav->chaseNode = nav->chaseTarget;
+        nav->chaseBusy = false;
+    }
+}
+
+// 目標に近づく辺を取得する
+//
+bool NavGetChaseEdge(int x, int y, struct NavEdge *edge)
+{
+    bool result = false;
+    int node = NavGetNode(x, y);
+    if (node != kNavNodeNull && nav->chaseNode != kNavNodeNull && nav->chaseCosts[node] != kNavCostNull && node != nav->chaseNode) {
+        int best = kNavCostNull;
+        for (int i = nav->edgeStarts[node]; i < nav->edgeStarts[node + 1]; i++) {
+            const struct NavEdge *e = &nav->edges[i];
+            if (nav->chaseCosts[e->node] != kNavCostNull && e->cost + nav->chaseCosts[e->node] < best) {
+                best = e->cost + nav->chaseCosts[e->node];
+                *edge = *e;
+                result = true;
+            }
+        }
+    }
+    return result;
+}
+
+// ヒープを操作する
+//
+static void NavPushHeap(int node, int cost)
+{
+    int i = nav->chaseHeapSize++;
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (nav->chaseHeaps[parent].cost <= cost) {
+            break;
+        }
+        nav->chaseHeaps[i] = nav->chaseHeaps[parent];
+        i = parent;
+    }
+    nav->chaseHeaps[i].node = node;
+    nav->chaseHeaps[i].cost = cost;
+}
+static struct NavHeap NavPopHeap(void)
+{
+    struct NavHeap result = nav->chaseHeaps[0];
+    struct NavHeap last = nav->chaseHeaps[--nav->chaseHeapSize];
+    int i = 0;
+    while (i * 2 + 1 < nav->chaseHeapSize) {
+        int child = i * 2 + 1;
+        if (child + 1 < nav->chaseHeapSize && nav->chaseHeaps[child + 1].cost < nav->chaseHeaps[child].cost) {
+            ++child;
+        }
+        if (last.cost <= nav->chaseHeaps[child].cost) {
+            break;
+        }
+        nav->chaseHeaps[i] = nav->chaseHeaps[child];
+        i = child;
+    }
+    nav->chaseHeaps[i] = last;
+    return result;
+}
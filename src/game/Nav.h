@@ -0,0 +1,166 @@
+// Nav.h - ナビゲーション
+//
+#pragma once
+
+// 外部参照
+//
+#include <stdbool.h>
+#include "pd_api.h"
+#include "Iocs.h"
+#include "Define.h"
+#include "Field.h"
+
+
+// 属性
+//
+enum {
+    kNavAttributeSpace = 0x01, 
+    kNavAttributeFall = 0x02, 
+    kNavAttributeLadder = 0x04, 
+    kNavAttributeStand = 0x08, 
+};
+
+// 節点
+//
+enum {
+    kNavNodeNull = -1, 
+};
+
+// 辺
+//
+enum {
+    kNavEdgeWalk = 0, 
+    kNavEdgeJump, 
+    kNavEdgeFall, 
+    kNavEdgeClimb, 
+    kNavEdgeSize, 
+};
+struct NavEdge {
+
+    // 行き先
+    unsigned short node;
+
+    // 種類
+    unsigned char type;
+
+    // コスト（フレーム数）
+    unsigned char cost;
+
+};
+
+// 軌跡
+//
+enum {
+    kNavJumpBoostSize = 2, 
+    kNavJumpDelay = 8, 
+    kNavJumpSize = (1 + 2 * 2) * kNavJumpBoostSize, 
+    kNavJumpFrameSize = 96, 
+};
+struct NavJumpFrame {
+
+    // 体が重なるタイル（開始タイルからの相対）
+    signed char center;
+    signed char left;
+    signed char right;
+    signed char top;
+    signed char bottom;
+
+    // 次のフレームで下のタイルに入る
+    bool land;
+
+};
+struct NavJump {
+
+    // フレーム
+    struct NavJumpFrame frames[kNavJumpFrameSize];
+    int frameSize;
+
+};
+
+// ヒープ
+//
+struct NavHeap {
+
+    // 節点
+    int node;
+
+    // コスト
+    int cost;
+
+};
+
+// 作成
+//
+enum {
+    kNavBuildNode = 0, 
+    kNavBuildEdge, 
+    kNavBuildReverse, 
+    kNavBuildDone, 
+};
+
+// コスト
+//
+enum {
+    kNavCostWalk = kFieldSizePixel / 4, 
+    kNavCostClimb = kFieldSizePixel / 4, 
+    kNavCostMaximum = 0xff, 
+    kNavCostNull = 0x7fffffff, 
+};
+
+// 追跡
+//
+enum {
+    kNavChaseStep = 512, 
+};
+
+// ナビゲーション
+//
+struct Nav {
+
+    // 作成
+    int build;
+    int buildRow;
+
+    // 属性
+    unsigned char attributes[kFieldSizeY][kFieldSizeX];
+
+    // 節点
+    short tileNodes[kFieldSizeY][kFieldSizeX];
+    unsigned short *nodeTiles;
+    int nodeSize;
+
+    // 辺（CSR）
+    int *edgeStarts;
+    struct NavEdge *edges;
+    int edgeSize;
+    int edgeCapacity;
+
+    // 逆向きの辺（CSR）
+    int *reverseStarts;
+    struct NavEdge *reverses;
+
+    // 軌跡
+    struct NavJump jumps[kNavJumpSize];
+
+    // 追跡（求め終わったコストを読みながら、次の目標のコストを少しずつ求める）
+    int chaseNode;
+    int chaseTarget;
+    bool chaseBusy;
+    int *chaseCosts;
+    int *chaseWrites;
+    struct NavHeap *chaseHeaps;
+    int chaseHeapSize;
+
+};
+
+// 外部参照関数
+//
+extern void NavInitialize(void);
+extern void NavRelease(void);
+extern bool NavBuild(int millisecond);
+extern int NavGetBuildProgress(void);
+extern int NavGetNode(int x, int y);
+extern int NavGetEdges(int node, const struct NavEdge **edges);
+extern void NavGetNodePosition(int node, struct Vector *position);
+extern void NavUpdateChase(int x, int y);
+extern bool NavGetChaseEdge(int x, int y, struct NavEdge *edge);
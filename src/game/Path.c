@@ -0,0 +1,614 @@
+// Path.c - 経路探索
+//
+
+// 外部参照
+//
+#include <string.h>
+#include "pd_api.h"
+#include "Iocs.h"
+#include "Scene.h"
+#include "Path.h"
+
+// 内部関数
+//
+static void PathUnbuild(struct Path *path);
+static int PathScanEntrance(struct Path *path, struct PathNode *nodes);
+static void PathAddEntrance(struct Path *path, struct PathNode *nodes, int x0, int y0, int x1, int y1);
+static bool PathIsSpace(struct Path *path, int x, int y);
+static int PathGetSection(struct Path *path, int x, int y);
+static int PathGetLocal(struct Path *path, int section, int x, int y);
+static void PathGetLocalPosition(struct Path *path, int section, int local, struct Vector *position);
+static int PathGetSectionOffset(struct Path *path, int section);
+static void PathSearchSection(struct Path *path, int search, int section, int x, int y);
+static int PathGetDistance(struct Path *path, int fromx, int fromy, int tox, int toy);
+static void PathRelax(struct Path *path, int node, int cost, int parent, int link, int tox, int toy);
+static void PathPushHeap(struct Path *path, int node, int score);
+static struct PathHeap PathPopHeap(struct Path *path);
+
+// 内部変数
+//
+
+
+// 経路探索を初期化する
+//
+struct Path *PathLoad(int sizex, int sizey, int sectionx, int sectiony)
+{
+    // Playdate の取得
+    PlaydateAPI *playdate = IocsGetPlaydate();
+    if (playdate == NULL) {
+        return NULL;
+    }
+
+    // 経路探索の作成
+    struct Path *path = (struct Path *)SceneAllocate(sizeof (struct Path));
+    if (path == NULL) {
+        playdate->system->error("%s: %d: path is not created.", __FILE__, __LINE__);
+    }
+    memset(path, 0, sizeof (struct Path));
+
+    // マップの作成
+    path->mapSize.x = sizex;
+    path->mapSize.y = sizey;
+    path->spaces = (unsigned char *)SceneAllocate(sizex * sizey * sizeof (unsigned char));
+    if (path->spaces == NULL) {
+        playdate->system->error("%s: %d: path map is not created.", __FILE__, __LINE__);
+    }
+    memset(path->spaces, 0, sizex * sizey * sizeof (unsigned char));
+
+    // 区画の作成
+    path->sectionSize.x = sectionx;
+    path->sectionSize.y = sectiony;
+    path->sectionCount.x = sizex / sectionx;
+    path->sectionCount.y = sizey / sectiony;
+    path->sectionNodes = (int *)SceneAllocate(path->sectionCount.x * path->sectionCount.y * sizeof (int));
+    path->sectionNodeSizes = (int *)SceneAllocate(path->sectionCount.x * path->sectionCount.y * sizeof (int));
+    if (path->sectionNodes == NULL || path->sectionNodeSizes == NULL) {
+        playdate->system->error("%s: %d: path section is not created.", __FILE__, __LINE__);
+    }
+
+    // 区画内の探索の作成
+    for (int i = 0; i < 2; i++) {
+        path->localCosts[i] = (int *)SceneAllocate(sectionx * sectiony * sizeof (int));
+        path->localParents[i] = (int *)SceneAllocate(sectionx * sectiony * sizeof (int));
+        if (path->localCosts[i] == NULL || path->localParents[i] == NULL) {
+            playdate->system->error("%s: %d: path local search is not created.", __FILE__, __LINE__);
+        }
+    }
+    path->localQueue = (int *)SceneAllocate(sectionx * sectiony * sizeof (int));
+    path->localOffsets = (int *)SceneAllocate(sectionx * sectiony * sizeof (int));
+    path->localNeighbors = (int *)SceneAllocate(sectionx * sectiony * kDirectionSize * sizeof (int));
+    if (path->localQueue == NULL || path->localOffsets == NULL || path->localNeighbors == NULL) {
+        playdate->system->error("%s: %d: path local queue is not created.", __FILE__, __LINE__);
+    }
+
+    // 区画内の位置と隣の表を作る（探索中の除算を避ける）
+    for (int y = 0; y < sectiony; y++) {
+        for (int x = 0; x < sectionx; x++) {
+            int local = y * sectionx + x;
+            int *neighbors = &path->localNeighbors[local * kDirectionSize];
+            path->localOffsets[local] = y * sizex + x;
+            neighbors[kDirectionUp] = y > 0 ? local - sectionx : -1;
+            neighbors[kDirectionDown] = y < sectiony - 1 ? local + sectionx : -1;
+            neighbors[kDirectionLeft] = x > 0 ? local - 1 : -1;
+            neighbors[kDirectionRight] = x < sectionx - 1 ? local + 1 : -1;
+        }
+    }
+
+    // 終了
+    return path;
+}
+
+// 経路探索を解放する
+//
+void PathUnload(struct Path *path)
+{
+    // Playdate の取得
+    PlaydateAPI *playdate = IocsGetPlaydate();
+    if (playdate == NULL) {
+        return;
+    }
+
+    // 経路探索の解放（区画と探索の表はシーンのアリーナと一緒に解放される）
+    if (path != NULL) {
+        PathUnbuild(path);
+    }
+}
+
+// 通れる位置を設定する
+//
+void PathSetSpace(struct Path *path, int x, int y, bool space)
+{
+    path->spaces[y * path->mapSize.x + x] = space ? 1 : 0;
+}
+
+// 抽象グラフを作成する
+//
+void PathBuild(struct Path *path)
+{
+    // Playdate の取得
+    PlaydateAPI *playdate = IocsGetPlaydate();
+    if (playdate == NULL) {
+        return;
+    }
+
+    // 前回のグラフの解放
+    PathUnbuild(path);
+
+    // 区画の境界の入口から節点を作る
+    int sectionSize = path->sectionCount.x * path->sectionCount.y;
+    struct PathNode *nodes = NULL;
+    {
+        int entranceSize = PathScanEntrance(path, NULL);
+        nodes = (struct PathNode *)IocsRealloc(kIocsMemoryTagPath, NULL, (entranceSize * 2 + 1) * sizeof (struct PathNode));
+        if (nodes == NULL) {
+            playdate->system->error("%s: %d: path node is not created.", __FILE__, __LINE__);
+        }
+        path->nodeSize = 0;
+        PathScanEntrance(path, nodes);
+    }
+
+    // 節点を区画ごとに並べる
+    {
+        int *remaps = (int *)IocsRealloc(kIocsMemoryTagPath, NULL, (path->nodeSize + 1) * sizeof (int));
+        path->nodes = (struct PathNode *)IocsRealloc(kIocsMemoryTagPath, NULL, (path->nodeSize + 1) * sizeof (struct PathNode));
+        if (remaps == NULL || path->nodes == NULL) {
+            playdate->system->error("%s: %d: path node is not created.", __FILE__, __LINE__);
+        }
+        memset(path->sectionNodeSizes, 0, sectionSize * sizeof (int));
+        for (int i = 0; i < path->nodeSize; i++) {
+            ++path->sectionNodeSizes[nodes[i].section];
+        }
+        for (int i = 0, n = 0; i < sectionSize; i++) {
+            path->sectionNodes[i] = n;
+            n += path->sectionNodeSizes[i];
+            path->sectionNodeSizes[i] = 0;
+        }
+        for (int i = 0; i < path->nodeSize; i++) {
+            int section = nodes[i].section;
+            remaps[i] = path->sectionNodes[section] + path->sectionNodeSizes[section]++;
+        }
+        for (int i = 0; i < path->nodeSize; i++) {
+            path->nodes[remaps[i]] = nodes[i];
+            path->nodes[remaps[i]].partner = remaps[nodes[i].partner];
+            path->nodes[remaps[i]].local = PathGetLocal(path, nodes[i].section, nodes[i].x, nodes[i].y);
+        }
+        IocsRealloc(kIocsMemoryTagPath, remaps, 0);
+        IocsRealloc(kIocsMemoryTagPath, nodes, 0);
+    }
+
+    // 辺の領域を確保する（辺は PathBuildSection で区画ごとに作る）
+    int edgeSize = path->nodeSize;
+    {
+        for (int i = 0; i < sectionSize; i++) {
+            edgeSize += path->sectionNodeSizes[i] * (path->sectionNodeSizes[i] - 1);
+        }
+        path->edges = (struct PathEdge *)IocsRealloc(kIocsMemoryTagPath, NULL, (edgeSize + 1) * sizeof (struct PathEdge));
+        if (path->edges == NULL) {
+            playdate->system->error("%s: %d: path edge is not created.", __FILE__, __LINE__);
+        }
+        path->edgeSize = 0;
+        path->tileSize = 0;
+        path->tileCapacity = 0;
+    }
+
+    // 抽象グラフの探索の作成
+    {
+        int size = path->nodeSize + 2;
+        path->costs = (int *)IocsRealloc(kIocsMemoryTagPath, NULL, size * sizeof (int));
+        path->parents = (int *)IocsRealloc(kIocsMemoryTagPath, NULL, size * sizeof (int));
+        path->links = (int *)IocsRealloc(kIocsMemoryTagPath, NULL, size * sizeof (int));
+        path->stamps = (int *)IocsRealloc(kIocsMemoryTagPath, NULL, size * sizeof (int));
+        path->heaps = (struct PathHeap *)IocsRealloc(kIocsMemoryTagPath, NULL, (edgeSize + size * 2) * sizeof (struct PathHeap));
+        if (path->costs == NULL || path->parents == NULL || path->links == NULL || path->stamps == NULL || path->heaps == NULL) {
+            playdate->system->error("%s: %d: path search is not created.", __FILE__, __LINE__);
+        }
+        memset(path->stamps, 0, size * sizeof (int));
+        path->stamp = 0;
+        path->heapSize = 0;
+    }
+}
+
+// 区画内の辺を作成する
+//
+void PathBuildSection(struct Path *path, int section)
+{
+    // Playdate の取得
+    PlaydateAPI *playdate = IocsGetPlaydate();
+    if (playdate == NULL) {
+        return;
+    }
+
+    // 入口の間の経路を探してキャッシュする（区画の順に呼ぶこと）
+    int offset = PathGetSectionOffset(path, section);
+    int first = path->sectionNodes[section];
+    int last = first + path->sectionNodeSizes[section];
+    for (int i = first; i < last; i++) {
+        struct PathNode *node = &path->nodes[i];
+        node->edge = path->edgeSize;
+
+        // 隣の区画への辺
+        {
+            struct PathEdge *edge = &path->edges[path->edgeSize++];
+            edge->node = node->partner;
+            edge->cost = 1;
+            edge->tile = 0;
+            edge->tileSize = 0;
+        }
+
+        // 区画内の辺
+        PathSearchSection(path, 0, section, node->x, node->y);
+        for (int j = first; j < last; j++) {
+            if (j != i) {
+                int local = path->nodes[j].local;
+                int cost = path->localCosts[0][local];
+                if (cost >= 0) {
+                    if (path->tileSize + cost > path->tileCapacity) {
+                        path->tileCapacity = path->tileCapacity > 0 ? path->tileCapacity * 2 : 1024;
+                        path->tiles = (unsigned short *)IocsRealloc(kIocsMemoryTagPath, path->tiles, path->tileCapacity * sizeof (unsigned short));
+                        if (path->tiles == NULL) {
+                            playdate->system->error("%s: %d: path tile is not created.", __FILE__, __LINE__);
+                        }
+                    }
+                    struct PathEdge *edge = &path->edges[path->edgeSize++];
+                    edge->node = j;
+                    edge->cost = cost;
+                    edge->tile = path->tileSize;
+                    edge->tileSize = cost;
+                    for (int k = cost - 1; k >= 0; k--) {
+                        path->tiles[path->tileSize + k] = (unsigned short)(offset + path->localOffsets[local]);
+                        local = path->localParents[0][local];
+                    }
+                    path->tileSize += cost;
+                }
+            }
+        }
+        node->edgeSize = path->edgeSize - node->edge;
+    }
+}
+
+// 抽象グラフを解放する
+//
+static void PathUnbuild(struct Path *path)
+{
+    // Playdate の取得
+    PlaydateAPI *playdate = IocsGetPlaydate();
+    if (playdate == NULL) {
+        return;
+    }
+
+    // グラフの解放
+    void **blocks[] = {
+        (void **)&path->nodes,
+        (void **)&path->edges,
+        (void **)&path->tiles,
+        (void **)&path->costs,
+        (void **)&path->parents,
+        (void **)&path->links,
+        (void **)&path->stamps,
+        (void **)&path->heaps,
+    };
+    for (int i = 0; i < (int)(sizeof (blocks) / sizeof (blocks[0])); i++) {
+        if (*blocks[i] != NULL) {
+            IocsRealloc(kIocsMemoryTagPath, *blocks[i], 0);
+            *blocks[i] = NULL;
+        }
+    }
+    path->nodeSize = 0;
+    path->edgeSize = 0;
+    path->tileSize = 0;
+}
+
+// 区画の境界の入口を探す
+//
+static int PathScanEntrance(struct Path *path, struct PathNode *nodes)
+{
+    int result = 0;
+    for (int sectiony = 0; sectiony < path->sectionCount.y; sectiony++) {
+        for (int sectionx = 0; sectionx < path->sectionCount.x; sectionx++) {
+
+            // 右の区画への入口（左右はつながっている）
+            {
+                int x0 = sectionx * path->sectionSize.x + path->sectionSize.x - 1;
+                int x1 = x0 + 1 < path->mapSize.x ? x0 + 1 : 0;
+                int start = -1;
+                for (int i = 0; i <= path->sectionSize.y; i++) {
+                    int y = sectiony * path->sectionSize.y + i;
+                    bool open = i < path->sectionSize.y && PathIsSpace(path, x0, y) && PathIsSpace(path, x1, y);
+                    if (open && start < 0) {
+                        start = i;
+                    } else if (!open && start >= 0) {
+                        int m = sectiony * path->sectionSize.y + (start + i - 1) / 2;
+                        if (nodes != NULL) {
+                            PathAddEntrance(path, nodes, x0, m, x1, m);
+                        }
+                        ++result;
+                        start = -1;
+                    }
+                }
+            }
+
+            // 下の区画への入口
+            if (sectiony < path->sectionCount.y - 1) {
+                int y0 = sectiony * path->sectionSize.y + path->sectionSize.y - 1;
+                int y1 = y0 + 1;
+                int start = -1;
+                for (int i = 0; i <= path->sectionSize.x; i++) {
+                    int x = sectionx * path->sectionSize.x + i;
+                    bool open = i < path->sectionSize.x && PathIsSpace(path, x, y0) && PathIsSpace(path, x, y1);
+                    if (open && start < 0) {
+                        start = i;
+                    } else if (!open && start >= 0) {
+                        int m = sectionx * path->sectionSize.x + (start + i - 1) / 2;
+                        if (nodes != NULL) {
+                            PathAddEntrance(path, nodes, m, y0, m, y1);
+                        }
+                        ++result;
+                        start = -1;
+                    }
+                }
+            }
+        }
+    }
+    return result;
+}
+static void PathAddEntrance(struct Path *path, struct PathNode *nodes, int x0, int y0, int x1, int y1)
+{
+    int n0 = path->nodeSize++;
+    int n1 = path->nodeSize++;
+    nodes[n0].x = x0;
+    nodes[n0].y = y0;
+    nodes[n0].section = PathGetSection(path, x0, y0);
+    nodes[n0].partner = n1;
+    nodes[n1].x = x1;
+    nodes[n1].y = y1;
+    nodes[n1].section = PathGetSection(path, x1, y1);
+    nodes[n1].partner = n0;
+}
+
+// 位置を判定する
+//
+static bool PathIsSpace(struct Path *path, int x, int y)
+{
+    return path->spaces[y * path->mapSize.x + x] != 0 ? true : false;
+}
+static int PathGetSection(struct Path *path, int x, int y)
+{
+    return (y / path->sectionSize.y) * path->sectionCount.x + (x / path->sectionSize.x);
+}
+static int PathGetLocal(struct Path *path, int section, int x, int y)
+{
+    int left = (section % path->sectionCount.x) * path->sectionSize.x;
+    int top = (section / path->sectionCount.x) * path->sectionSize.y;
+    return (y - top) * path->sectionSize.x + (x - left);
+}
+static void PathGetLocalPosition(struct Path *path, int section, int local, struct Vector *position)
+{
+    position->x = (section % path->sectionCount.x) * path->sectionSize.x + local % path->sectionSize.x;
+    position->y = (section / path->sectionCount.x) * path->sectionSize.y + local / path->sectionSize.x;
+}
+static int PathGetSectionOffset(struct Path *path, int section)
+{
+    int left = (section % path->sectionCount.x) * path->sectionSize.x;
+    int top = (section / path->sectionCount.x) * path->sectionSize.y;
+    return top * path->mapSize.x + left;
+}
+
+// 区画内を幅優先で探索する
+//
+static void PathSearchSection(struct Path *path, int search, int section, int x, int y)
+{
+    int *costs = path->localCosts[search];
+    int *parents = path->localParents[search];
+    int size = path->sectionSize.x * path->sectionSize.y;
+    for (int i = 0; i < size; i++) {
+        costs[i] = -1;
+        parents[i] = -1;
+    }
+    int head = 0;
+    int tail = 0;
+    int offset = PathGetSectionOffset(path, section);
+    int local = PathGetLocal(path, section, x, y);
+    costs[local] = 0;
+    path->localQueue[tail++] = local;
+    while (head < tail) {
+        int l = path->localQueue[head++];
+        const int *neighbors = &path->localNeighbors[l * kDirectionSize];
+        for (int i = 0; i < kDirectionSize; i++) {
+            int n = neighbors[i];
+            if (n >= 0 && costs[n] < 0 && path->spaces[offset + path->localOffsets[n]] != 0) {
+                costs[n] = costs[l] + 1;
+                parents[n] = l;
+                path->localQueue[tail++] = n;
+            }
+        }
+    }
+}
+
+// 左右のつながりを考慮した距離を取得する
+//
+static int PathGetDistance(struct Path *path, int fromx, int fromy, int tox, int toy)
+{
+    int dx = fromx > tox ? fromx - tox : tox - fromx;
+    int dy = fromy > toy ? fromy - toy : toy - fromy;
+    if (dx > path->mapSize.x - dx) {
+        dx = path->mapSize.x - dx;
+    }
+    return dx + dy;
+}
+
+// 経路を探す
+//
+int PathFind(struct Path *path, int fromx, int fromy, int tox, int toy, struct Vector *tiles, int size)
+{
+    // 位置の確認
+    while (fromx < 0) {
+        fromx += path->mapSize.x;
+    }
+    while (tox < 0) {
+        tox += path->mapSize.x;
+    }
+    fromx %= path->mapSize.x;
+    tox %= path->mapSize.x;
+    if (path->nodes == NULL || fromy < 0 || fromy >= path->mapSize.y || toy < 0 || toy >= path->mapSize.y) {
+        return kPathNull;
+    }
+    if (!PathIsSpace(path, fromx, fromy) || !PathIsSpace(path, tox, toy)) {
+        return kPathNull;
+    }
+    if (fromx == tox && fromy == toy) {
+        return 0;
+    }
+
+    // 同じ区画内なら区画内の探索だけで済ませる
+    int fromSection = PathGetSection(path, fromx, fromy);
+    int toSection = PathGetSection(path, tox, toy);
+    PathSearchSection(path, 0, fromSection, fromx, fromy);
+    if (fromSection == toSection) {
+        int local = PathGetLocal(path, toSection, tox, toy);
+        int cost = path->localCosts[0][local];
+        if (cost >= 0) {
+            if (cost > size) {
+                return kPathNull;
+            }
+            for (int i = cost - 1; i >= 0; i--) {
+                PathGetLocalPosition(path, toSection, local, &tiles[i]);
+                local = path->localParents[0][local];
+            }
+            return cost;
+        }
+    }
+    PathSearchSection(path, 1, toSection, tox, toy);
+
+    // 抽象グラフを A* で探索する
+    int start = path->nodeSize;
+    int goal = path->nodeSize + 1;
+    ++path->stamp;
+    path->heapSize = 0;
+    path->stamps[start] = path->stamp;
+    path->costs[start] = 0;
+    path->parents[start] = kPathNull;
+    path->links[start] = kPathNull;
+    for (int i = 0; i < path->sectionNodeSizes[fromSection]; i++) {
+        int n = path->sectionNodes[fromSection] + i;
+        int cost = path->localCosts[0][path->nodes[n].local];
+        if (cost >= 0) {
+            PathRelax(path, n, cost, start, kPathNull, tox, toy);
+        }
+    }
+    while (path->heapSize > 0) {
+        struct PathHeap heap = PathPopHeap(path);
+        if (heap.node == goal) {
+            break;
+        }
+        struct PathNode *node = &path->nodes[heap.node];
+        int cost = path->costs[heap.node];
+        if (heap.score > cost + PathGetDistance(path, node->x, node->y, tox, toy)) {
+            continue;
+        }
+        if (node->section == toSection) {
+            int local = path->localCosts[1][node->local];
+            if (local >= 0) {
+                PathRelax(path, goal, cost + local, heap.node, kPathNull, tox, toy);
+            }
+        }
+        for (int i = 0; i < node->edgeSize; i++) {
+            struct PathEdge *edge = &path->edges[node->edge + i];
+            PathRelax(path, edge->node, cost + edge->cost, heap.node, node->edge + i, tox, toy);
+        }
+    }
+    if (path->stamps[goal] != path->stamp || path->costs[goal] > size) {
+        return kPathNull;
+    }
+
+    // 後ろから経路を復元する
+    int result = path->costs[goal];
+    int index = result;
+    {
+        // 最後の節点から目標まで
+        int n = path->parents[goal];
+        int local = path->nodes[n].local;
+        int cost = path->localCosts[1][local];
+        index -= cost;
+        for (int i = 0; i < cost; i++) {
+            local = path->localParents[1][local];
+            PathGetLocalPosition(path, toSection, local, &tiles[index + i]);
+        }
+
+        // 節点の間
+        while (path->parents[n] != start) {
+            int link = path->links[n];
+            struct PathEdge *edge = &path->edges[link];
+            if (edge->tileSize == 0 && edge->cost > 0) {
+                tiles[--index].x = path->nodes[n].x;
+                tiles[index].y = path->nodes[n].y;
+            } else {
+                index -= edge->tileSize;
+                for (int i = 0; i < edge->tileSize; i++) {
+                    tiles[index + i].x = path->tiles[edge->tile + i] % path->mapSize.x;
+                    tiles[index + i].y = path->tiles[edge->tile + i] / path->mapSize.x;
+                }
+            }
+            n = path->parents[n];
+        }
+
+        // 開始位置から最初の節点まで
+        local = path->nodes[n].local;
+        while (index > 0) {
+            PathGetLocalPosition(path, fromSection, local, &tiles[--index]);
+            local = path->localParents[0][local];
+        }
+    }
+
+    // 終了
+    return result;
+}
+
+// 節点のコストを更新する
+//
+static void PathRelax(struct Path *path, int node, int cost, int parent, int link, int tox, int toy)
+{
+    if (path->stamps[node] != path->stamp || cost < path->costs[node]) {
+        path->stamps[node] = path->stamp;
+        path->costs[node] = cost;
+        path->parents[node] = parent;
+        path->links[node] = link;
+        int distance = node < path->nodeSize ? PathGetDistance(path, path->nodes[node].x, path->nodes[node].y, tox, toy) : 0;
+        PathPushHeap(path, node, cost + distance);
+    }
+}
+
+// ヒープを操作する
+//
+static void PathPushHeap(struct Path *path, int node, int score)
+{
+    int i = path->heapSize++;
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (path->heaps[parent].score <= score) {
+            break;
+        }
+        path->heaps[i] = path->heaps[parent];
+        i = parent;
+    }
+    path->heaps[i].node = node;
+    path->heaps[i].score = score;
+}
+static struct PathHeap PathPopHeap(struct Path *path)
+{
+    struct PathHeap result = path->heaps[0];
+    struct PathHeap last = path->heaps[--path->heapSize];
+    int i = 0;
+    while (i * 2 + 1 < path->heapSize) {
+        int child = i * 2 + 1;
+        if (child + 1 < path->heapSize && path->heaps[child + 1].score < path->heaps[child].score) {
+            ++child;
+        }
+        if (last.score <= path->heaps[child].score) {
+            break;
+        }
+        path->heaps[i] = path->heaps[child];
+        i = child;
+    }
+    path->heaps[i] = last;
+    return result;
+}
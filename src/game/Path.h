@@ -0,0 +1,120 @@
+// Path.h - 経路探索
+//
+#pragma once
+
+// 外部参照
+//
+#include <stdbool.h>
+#include "pd_api.h"
+#include "Iocs.h"
+#include "Define.h"
+
+
+// 経路
+//
+enum {
+    kPathNull = -1, 
+};
+
+// 節点
+//
+struct PathNode {
+
+    // 位置
+    int x;
+    int y;
+
+    // 区画
+    int section;
+    int local;
+
+    // 隣の区画の節点
+    int partner;
+
+    // 辺
+    int edge;
+    int edgeSize;
+
+};
+
+// 辺
+//
+struct PathEdge {
+
+    // 行き先
+    int node;
+
+    // コスト
+    int cost;
+
+    // 区画内の経路のキャッシュ
+    int tile;
+    int tileSize;
+
+};
+
+// ヒープ
+//
+struct PathHeap {
+
+    // 節点
+    int node;
+
+    // 評価値
+    int score;
+
+};
+
+// 経路探索
+//
+struct Path {
+
+    // マップ
+    unsigned char *spaces;
+    struct Vector mapSize;
+
+    // 区画
+    struct Vector sectionSize;
+    struct Vector sectionCount;
+    int *sectionNodes;
+    int *sectionNodeSizes;
+
+    // 節点
+    struct PathNode *nodes;
+    int nodeSize;
+
+    // 辺
+    struct PathEdge *edges;
+    int edgeSize;
+
+    // 区画内の経路
+    unsigned short *tiles;
+    int tileSize;
+    int tileCapacity;
+
+    // 区画内の探索
+    int *localCosts[2];
+    int *localParents[2];
+    int *localQueue;
+    int *localOffsets;
+    int *localNeighbors;
+
+    // 抽象グラフの探索
+    int *costs;
+    int *parents;
+    int *links;
+    int *stamps;
+    int stamp;
+    struct PathHeap *heaps;
+    int heapSize;
+
+};
+
+// 外部参照関数
+//
+extern struct Path *PathLoad(int sizex, int sizey, int sectionx, int sectiony);
+extern void PathUnload(struct Path *path);
+extern void PathSetSpace(struct Path *path, int x, int y, bool space);
+extern void PathBuild(struct Path *path);
+extern void PathBuildSection(struct Path *path, int section);
+extern int PathFind(struct Path *path, int fromx, int fromy, int tox, int toy, struct Vector *tiles, int size);
@@ -6,6 +6,7 @@
 #include <string.h>
 #include "pd_api.h"
 #include "Iocs.h"
+#include "Scene.h"
 #include "Actor.h"
 #include "Game.h"
 #include "Field.h"
@@ -35,7 +36,7 @@ void PlayerInitialize(void)
     }
 
     // プレイヤの作成
-    player = (struct Player *)playdate->system->realloc(NULL, sizeof (struct Player));
+    player = (struct Player *)SceneAllocate(sizeof (struct Player));
     if (player == NULL) {
         playdate->system->error("%s: %d: player instance is not created.", __FILE__, __LINE__);
     }
@@ -60,8 +61,7 @@ void PlayerRelease(void)
     // プレイヤの解放
     if (player != NULL) {
 
-        // プレイヤの解放
-        playdate->system->realloc(player, 0);
+        // プレイヤの解放（メモリはシーンのアリーナと一緒に解放される）
         player = NULL;
     }
 }
@@ -94,6 +94,7 @@ struct PlayerActor {
 
     // 移動
     struct Vector moveVector;
+    struct Vector moveFraction;
     struct Rect moveRect;
 
     // ジャンプ
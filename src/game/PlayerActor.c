@@ -10,6 +10,7 @@
 #include "Game.h"
 #include "Field.h"
 #include "Player.h"
+#include "Hit.h"
 
 // 内部関数
 //
@@ -21,9 +22,9 @@ static void PlayerActorClimb(struct PlayerActor *actor);
 static void PlayerActorAttack(struct PlayerActor *actor);
 static void PlayerActorClearCrank(struct PlayerActor *actor);
 static void PlayerActorInputCrank(struct PlayerActor *actor);
-static void PlayerActorMoveVtoH(struct PlayerActor *actor, int movex, int movey);
-static void PlayerActorMoveHtoV(struct PlayerActor *actor, int movex, int movey);
+static void PlayerActorMove(struct PlayerActor *actor, int flags);
 static void PlayerActorBlink(struct PlayerActor *actor);
+static void PlayerActorHit(struct PlayerActor *actor);
 static bool PlayerActorIsGrabLadder(struct PlayerActor *actor);
 static bool PlayerActorIsDownLadder(struct PlayerActor *actor);
 
@@ -35,6 +36,10 @@ static const struct Rect playerActorMoveRect = {
     .right = 6, 
     .bottom = 0, 
 };
+static const struct Rect playerActorAttackRects[kFaceSize] = {
+    {.left = -31, .top = -23, .right = -8, .bottom = 0, }, 
+    {.left = 7, .top = -23, .right = 30, .bottom = 0, }, 
+};
 static const char *playerActorSpriteName = "player";
 static const char *playerActorAnimationNames_Idle[kFaceSize] = {
     "IdleLeft", 
@@ -106,6 +111,8 @@ void PlayerActorLoad(void)
         // 移動の設定
         actor->moveVector.x = 0;
         actor->moveVector.y = 0;
+        actor->moveFraction.x = 0;
+        actor->moveFraction.y = 0;
         actor->moveRect.left = actor->position.x + playerActorMoveRect.left;
         actor->moveRect.top = actor->position.y + playerActorMoveRect.top;
         actor->moveRect.right = actor->position.x + playerActorMoveRect.right;
@@ -146,13 +153,14 @@ static void PlayerActorDraw(struct PlayerActor *actor)
     // スプライトの描画
     if ((actor->blink & kPlayerBlinkInterval) == 0) {
         struct Vector view;
-        GameGetFieldCameraPosition(actor->position.x, actor->position.y, &view);
-        AsepriteDrawRotatedSpriteAnimation(&actor->animation, view.x, view.y, 0.0f, 0.5f, 0.75f, 1.0f, 1.0f, kDrawModeCopy);
+        if (GameGetFieldSpritePosition(actor->position.x, actor->position.y, &actor->animation, 0.5f, 0.75f, &view)) {
+            AsepriteDrawRotatedSpriteAnimation(&actor->animation, view.x, view.y, 0.0f, 0.5f, 0.75f, 1.0f, 1.0f, kDrawModeCopy);
+        }
     }
 
     // DEBUG
     {
-        GameDrawFieldRect(&actor->moveRect, kDrawModeCopy, kColorWhite);
+        GameDrawFieldRect(&actor->moveRect, kColorWhite);
     }
 
     // クリップの解除
@@ -278,7 +286,7 @@ static void PlayerActorWalk(struct PlayerActor *actor)
         // 移動
         {
             int y = actor->position.y;
-            PlayerActorMoveHtoV(actor, actor->moveVector.x >> kPlayerMoveShift, actor->moveVector.y >> kPlayerMoveShift);
+            PlayerActorMove(actor, 0);
             if (actor->moveVector.y < 0) {
                 if (PlayerActorIsGrabLadder(actor)) {
                     actor->action = kPlayerActionClimb;
@@ -307,6 +315,9 @@ static void PlayerActorWalk(struct PlayerActor *actor)
         // 点滅
         PlayerActorBlink(actor);
 
+        // 当たり判定
+        PlayerActorHit(actor);
+
         // アニメーションの更新
         if (animation != NULL) {
             AsepriteStartSpriteAnimation(&actor->animation, playerActorSpriteName, animation, true);
@@ -421,11 +432,14 @@ static void PlayerActorJump(struct PlayerActor *actor)
         }
 
         // 移動
-        PlayerActorMoveVtoH(actor, actor->moveVector.x >> kPlayerMoveShift, actor->moveVector.y >> kPlayerMoveShift);
+        PlayerActorMove(actor, kFieldSweepFall);
 
         // 点滅
         PlayerActorBlink(actor);
 
+        // 当たり判定
+        PlayerActorHit(actor);
+
         // アニメーションの更新
         if (animation != NULL) {
             AsepriteStartSpriteAnimation(&actor->animation, playerActorSpriteName, animation, true);
@@ -533,11 +547,14 @@ static void PlayerActorClimb(struct PlayerActor *actor)
         }
 
         // 移動
-        PlayerActorMoveHtoV(actor, actor->moveVector.x >> kPlayerMoveShift, actor->moveVector.y >> kPlayerMoveShift);
+        PlayerActorMove(actor, 0);
 
         // 点滅
         PlayerActorBlink(actor);
 
+        // 当たり判定
+        PlayerActorHit(actor);
+
         // アニメーションの更新
         if (animation != NULL) {
             AsepriteStartSpriteAnimation(&actor->animation, playerActorSpriteName, animation, true);
@@ -616,11 +633,14 @@ static void PlayerActorAttack(struct PlayerActor *actor)
         }
 
         // 移動
-        PlayerActorMoveHtoV(actor, actor->moveVector.x >> kPlayerMoveShift, actor->moveVector.y >> kPlayerMoveShift);
+        PlayerActorMove(actor, 0);
 
         // 点滅
         PlayerActorBlink(actor);
 
+        // 当たり判定
+        PlayerActorHit(actor);
+
         // アニメーションの更新
         if (animation != NULL) {
             AsepriteStartSpriteAnimation(&actor->animation, playerActorSpriteName, animation, false);
@@ -655,113 +675,10 @@ static void PlayerActorInputCrank(struct PlayerActor *actor)
 
 // 移動する
 //
-static void PlayerActorMoveVtoH(struct PlayerActor *actor, int movex, int movey)
+static void PlayerActorMove(struct PlayerActor *actor, int flags)
 {
-    if (movey < 0) {
-        movey = -movey;
-        int d_0 = actor->moveRect.top % kFieldSizePixel;
-        int d_1 = 0;
-        if (d_0 > movey) {
-            d_0 = movey;
-        } else {
-            d_1 = movey - d_0;
-        }
-        if (d_0 > 0) {
-            if (FieldMoveRect(&actor->moveRect, kDirectionUp, d_0, FieldIsSpace, &actor->moveRect) == 0) {
-                d_1 = 0;
-            }
-        }
-        if (movex < 0) {
-            FieldMoveRect(&actor->moveRect, kDirectionLeft, -movex, FieldIsSpace, &actor->moveRect);
-        } else if (movex > 0) {
-            FieldMoveRect(&actor->moveRect, kDirectionRight, movex, FieldIsSpace, &actor->moveRect);
-        }
-        if (d_1 > 0) {
-            FieldMoveRect(&actor->moveRect, kDirectionUp, d_1, FieldIsSpace, &actor->moveRect);
-        }
-    } else if (movey > 0) {
-        int d_0 = (kFieldSizePixel - 1) - (actor->moveRect.bottom % kFieldSizePixel);
-        int d_1 = 0;
-        if (d_0 > movey) {
-            d_0 = movey;
-        } else {
-            d_1 = movey - d_0;
-        }
-        if (d_0 > 0) {
-            if (FieldMoveRect(&actor->moveRect, kDirectionDown, d_0, FieldIsSpace, &actor->moveRect) == 0) {
-                d_1 = 0;
-            }
-        }
-        if (movex < 0) {
-            FieldMoveRect(&actor->moveRect, kDirectionLeft, -movex, FieldIsSpace, &actor->moveRect);
-        } else if (movex > 0) {
-            FieldMoveRect(&actor->moveRect, kDirectionRight, movex, FieldIsSpace, &actor->moveRect);
-        }
-        if (d_1 > 0) {
-            FieldMoveRect(&actor->moveRect, kDirectionDown, d_1, FieldIsFall, &actor->moveRect);
-        }
-    } else {
-        if (movex < 0) {
-            FieldMoveRect(&actor->moveRect, kDirectionLeft, -movex, FieldIsSpace, &actor->moveRect);
-        } else if (movex > 0) {
-            FieldMoveRect(&actor->moveRect, kDirectionRight, movex, FieldIsSpace, &actor->moveRect);
-        }
-    }
-    actor->position.x = actor->moveRect.left - playerActorMoveRect.left;
-    actor->position.y = actor->moveRect.top - playerActorMoveRect.top;
-}
-static void PlayerActorMoveHtoV(struct PlayerActor *actor, int movex, int movey)
-{
-    if (movex < 0) {
-        movex = -movex;
-        int d_0 = actor->moveRect.left % kFieldSizePixel;
-        int d_1 = 0;
-        if (d_0 > movex) {
-            d_0 = movex;
-        } else {
-            d_1 = movex - d_0;
-        }
-        if (d_0 > 0) {
-            if (FieldMoveRect(&actor->moveRect, kDirectionLeft, d_0, FieldIsSpace, &actor->moveRect) == 0) {
-                d_1 = 0;
-            }
-        }
-        if (movey < 0) {
-            FieldMoveRect(&actor->moveRect, kDirectionUp, -movey, FieldIsSpace, &actor->moveRect);
-        } else if (movey > 0) {
-            FieldMoveRect(&actor->moveRect, kDirectionDown, movey, FieldIsSpace, &actor->moveRect);
-        }
-        if (d_1 > 0) {
-            FieldMoveRect(&actor->moveRect, kDirectionLeft, d_1, FieldIsSpace, &actor->moveRect);
-        }
-    } else if (movex > 0) {
-        int d_0 = (kFieldSizePixel - 1) - (actor->moveRect.right % kFieldSizePixel);
-        int d_1 = 0;
-        if (d_0 > movex) {
-            d_0 = movex;
-        } else {
-            d_1 = movex - d_0;
-        }
-        if (d_0 > 0) {
-            if (FieldMoveRect(&actor->moveRect, kDirectionRight, d_0, FieldIsSpace, &actor->moveRect) == 0) {
-                d_1 = 0;
-            }
-        }
-        if (movey < 0) {
-            FieldMoveRect(&actor->moveRect, kDirectionUp, -movey, FieldIsSpace, &actor->moveRect);
-        } else if (movey > 0) {
-            FieldMoveRect(&actor->moveRect, kDirectionDown, movey, FieldIsSpace, &actor->moveRect);
-        }
-        if (d_1 > 0) {
-            FieldMoveRect(&actor->moveRect, kDirectionRight, d_1, FieldIsSpace, &actor->moveRect);
-        }
-    } else {
-        if (movey < 0) {
-            FieldMoveRect(&actor->moveRect, kDirectionUp, -movey, FieldIsSpace, &actor->moveRect);
-        } else if (movey > 0) {
-            FieldMoveRect(&actor->moveRect, kDirectionDown, movey, FieldIsSpace, &actor->moveRect);
-        }
-    }
+    struct FieldSweep sweep;
+    FieldSweepRect(&actor->moveRect, &actor->moveFraction, actor->moveVector.x, actor->moveVector.y, flags, &sweep);
     actor->position.x = actor->moveRect.left - playerActorMoveRect.left;
     actor->position.y = actor->moveRect.top - playerActorMoveRect.top;
 }
@@ -775,6 +692,33 @@ static void PlayerActorBlink(struct PlayerActor *actor)
     }
 }
 
+// 当たり判定を行う
+//
+static void PlayerActorHit(struct PlayerActor *actor)
+{
+    // エネミーとの接触
+    {
+        const struct HitContact *contacts;
+        if (HitGetContacts(kHitContactPlayerEnemy, &contacts) > 0 && actor->blink == 0) {
+            actor->blink = kPlayerBlinkDamage;
+        }
+    }
+
+    // 体の矩形の登録
+    HitAddRect(kHitCategoryPlayer, 0, &actor->moveRect);
+
+    // 攻撃の矩形の登録
+    if (actor->action == kPlayerActionAttack) {
+        struct Rect rect = {
+            .left = actor->position.x + playerActorAttackRects[actor->face].left, 
+            .top = actor->position.y + playerActorAttackRects[actor->face].top, 
+            .right = actor->position.x + playerActorAttackRects[actor->face].right, 
+            .bottom = actor->position.y + playerActorAttackRects[actor->face].bottom, 
+        };
+        HitAddRect(kHitCategoryAttack, 0, &rect);
+    }
+}
+
 // 梯子を掴んでいるかどうかを判定する
 //
 static bool PlayerActorIsGrabLadder(struct PlayerActor *actor)
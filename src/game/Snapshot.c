@@ -0,0 +1,283 @@
+// Snapshot.c - スナップショット
+//
+
+// 外部参照
+//
+#include <string.h>
+#include "pd_api.h"
+#include "Iocs.h"
+#include "Scene.h"
+#include "Actor.h"
+#include "Game.h"
+#include "Player.h"
+#include "Enemy.h"
+#include "Hit.h"
+#include "Snapshot.h"
+
+// 内部関数
+//
+static bool SnapshotCreateBuffers(void);
+static bool SnapshotWriteSlot(int slot);
+static bool SnapshotReadSlot(int slot);
+static int SnapshotWrite(unsigned char *buffer, int offset, const void *data, int size);
+static int SnapshotRead(const unsigned char *buffer, int offset, void *data, int size);
+
+// 内部変数
+//
+static struct Snapshot *snapshot = NULL;
+
+
+// スナップショットを初期化する
+//
+void SnapshotInitialize(void)
+{
+    // Playdate の取得
+    PlaydateAPI *playdate = IocsGetPlaydate();
+    if (playdate == NULL) {
+        return;
+    }
+
+    // スナップショットの作成
+    snapshot = (struct Snapshot *)SceneAllocate(sizeof (struct Snapshot));
+    if (snapshot == NULL) {
+        playdate->system->error("%s: %d: snapshot instance is not created.", __FILE__, __LINE__);
+        return;
+    }
+    memset(snapshot, 0, sizeof (struct Snapshot));
+
+    // バッファは最初に記録するときに作成する
+    snapshot->buffers = NULL;
+}
+
+// スナップショットを解放する
+//
+void SnapshotRelease(void)
+{
+    // Playdate の取得
+    PlaydateAPI *playdate = IocsGetPlaydate();
+    if (playdate == NULL) {
+        return;
+    }
+
+    // スナップショットの解放（メモリはシーンのアリーナと一緒に解放される）
+    snapshot = NULL;
+}
+
+// 現在の状態をリングバッファに記録する
+//
+bool SnapshotTake(void)
+{
+    if (!SnapshotCreateBuffers() || !SnapshotWriteSlot(snapshot->ringHead)) {
+        return false;
+    }
+    snapshot->ringHead = (snapshot->ringHead + 1) % kSnapshotRingSize;
+    if (snapshot->ringSize < kSnapshotRingSize) {
+        ++snapshot->ringSize;
+    }
+    return true;
+}
+
+// 指定したフレーム数だけ前の状態に戻す（戻した記録とそれより新しい記録は破棄される）
+//
+bool SnapshotRewind(int frame)
+{
+    if (snapshot == NULL || snapshot->buffers == NULL || frame < 1 || frame > snapshot->ringSize) {
+        return false;
+    }
+    int slot = (snapshot->ringHead - frame + kSnapshotRingSize) % kSnapshotRingSize;
+    if (!SnapshotReadSlot(slot)) {
+        return false;
+    }
+    snapshot->ringHead = slot;
+    snapshot->ringSize -= frame;
+    return true;
+}
+
+// 巻き戻せるフレーム数を取得する
+//
+int SnapshotGetRewindSize(void)
+{
+    return snapshot != NULL ? snapshot->ringSize : 0;
+}
+
+// 現在の状態を保存する
+//
+bool SnapshotSave(void)
+{
+    return SnapshotCreateBuffers() && SnapshotWriteSlot(kSnapshotSlotSave) ? true : false;
+}
+
+// 保存した状態を読み込む
+//
+bool SnapshotLoad(void)
+{
+    return snapshot != NULL && snapshot->buffers != NULL && SnapshotReadSlot(kSnapshotSlotSave) ? true : false;
+}
+
+// バッファを作成する（作成済みなら何もしない）
+//
+static bool SnapshotCreateBuffers(void)
+{
+    // Playdate の取得
+    PlaydateAPI *playdate = IocsGetPlaydate();
+    if (playdate == NULL || snapshot == NULL) {
+        return false;
+    }
+
+    // バッファの作成
+    if (snapshot->buffers == NULL) {
+        snapshot->buffers = (unsigned char *)SceneAllocate(kSnapshotSlotSize * kSnapshotBufferSize);
+        if (snapshot->buffers == NULL) {
+            playdate->system->error("%s: %d: snapshot buffer is not created.", __FILE__, __LINE__);
+            return false;
+        }
+    }
+    return true;
+}
+
+// スロットに書き込む
+//
+static bool SnapshotWriteSlot(int slot)
+{
+    // Playdate の取得
+    PlaydateAPI *playdate = IocsGetPlaydate();
+    if (playdate == NULL) {
+        return false;
+    }
+
+    // 状態の確認
+    struct Iocs *iocs = IocsGetInstance();
+    struct Vector *camera = GameGetCamera();
+    struct Hit *hit = HitGetInstance();
+    if (camera == NULL || player == NULL || enemy == NULL || hit == NULL) {
+        return false;
+    }
+    unsigned char *buffer = snapshot->buffers + slot * kSnapshotBufferSize;
+    snapshot->sizes[slot] = 0;
+
+    // ヘッダ
+    struct SnapshotHeader header;
+    header.magic = kSnapshotMagic;
+    header.random = iocs->random;
+    memcpy(header.buttonRepeatCounts, iocs->buttonRepeatCounts, sizeof (header.buttonRepeatCounts));
+    int offset = sizeof (struct SnapshotHeader);
+
+    // アクタ
+    {
+        int size = ActorSave(buffer + offset, kSnapshotBufferSize - offset);
+        offset = size > 0 ? offset + size : -1;
+    }
+
+    // カメラ
+    offset = SnapshotWrite(buffer, offset, camera, sizeof (struct Vector));
+
+    // プレイヤ
+    offset = SnapshotWrite(buffer, offset, player, sizeof (struct Player));
+
+    // エネミー（振る舞いと命令は読み込み後に変化しない）
+    offset = SnapshotWrite(buffer, offset, enemy->pools, sizeof (enemy->pools));
+    offset = SnapshotWrite(buffer, offset, enemy->cellHeads, sizeof (enemy->cellHeads));
+    offset = SnapshotWrite(buffer, offset, &enemy->batch, sizeof (struct EnemyBatch));
+    offset = SnapshotWrite(buffer, offset, &enemy->random, sizeof (struct IocsRandom));
+
+    // 当たり判定（次のフレームで使う接触だけ）
+    offset = SnapshotWrite(buffer, offset, hit->contacts, sizeof (hit->contacts));
+    offset = SnapshotWrite(buffer, offset, hit->contactSizes, sizeof (hit->contactSizes));
+
+    // ヘッダの書き込み
+    if (offset < 0) {
+        if (!snapshot->overflow) {
+            playdate->system->logToConsole("%s: %d: snapshot buffer is too small.", __FILE__, __LINE__);
+            snapshot->overflow = true;
+        }
+        return false;
+    }
+    header.size = offset;
+    memcpy(buffer, &header, sizeof (struct SnapshotHeader));
+    snapshot->sizes[slot] = offset;
+
+    // 終了
+    return true;
+}
+
+// スロットから読み込む
+//
+static bool SnapshotReadSlot(int slot)
+{
+    // Playdate の取得
+    PlaydateAPI *playdate = IocsGetPlaydate();
+    if (playdate == NULL) {
+        return false;
+    }
+
+    // 状態の確認
+    struct Iocs *iocs = IocsGetInstance();
+    struct Vector *camera = GameGetCamera();
+    struct Hit *hit = HitGetInstance();
+    if (camera == NULL || player == NULL || enemy == NULL || hit == NULL) {
+        return false;
+    }
+    const unsigned char *buffer = snapshot->buffers + slot * kSnapshotBufferSize;
+
+    // ヘッダ
+    struct SnapshotHeader header;
+    memcpy(&header, buffer, sizeof (struct SnapshotHeader));
+    if (snapshot->sizes[slot] == 0 || header.magic != kSnapshotMagic || header.size != snapshot->sizes[slot]) {
+        return false;
+    }
+    iocs->random = header.random;
+    memcpy(iocs->buttonRepeatCounts, header.buttonRepeatCounts, sizeof (header.buttonRepeatCounts));
+    int offset = sizeof (struct SnapshotHeader);
+
+    // アクタ
+    {
+        int size = ActorRestore(buffer + offset, header.size - offset);
+        offset = size > 0 ? offset + size : -1;
+    }
+
+    // カメラ
+    offset = SnapshotRead(buffer, offset, camera, sizeof (struct Vector));
+
+    // プレイヤ
+    offset = SnapshotRead(buffer, offset, player, sizeof (struct Player));
+
+    // エネミー
+    offset = SnapshotRead(buffer, offset, enemy->pools, sizeof (enemy->pools));
+    offset = SnapshotRead(buffer, offset, enemy->cellHeads, sizeof (enemy->cellHeads));
+    offset = SnapshotRead(buffer, offset, &enemy->batch, sizeof (struct EnemyBatch));
+    offset = SnapshotRead(buffer, offset, &enemy->random, sizeof (struct IocsRandom));
+
+    // 当たり判定
+    offset = SnapshotRead(buffer, offset, hit->contacts, sizeof (hit->contacts));
+    offset = SnapshotRead(buffer, offset, hit->contactSizes, sizeof (hit->contactSizes));
+    hit->rectSize = 0;
+
+    // 終了
+    if (offset != header.size) {
+        playdate->system->error("%s: %d: snapshot is broken.", __FILE__, __LINE__);
+        return false;
+    }
+    return true;
+}
+
+// バッファに書き込む
+//
+static int SnapshotWrite(unsigned char *buffer, int offset, const void *data, int size)
+{
+    if (offset < 0 || offset + size > kSnapshotBufferSize) {
+        return -1;
+    }
+    memcpy(buffer + offset, data, size);
+    return offset + size;
+}
+
+// バッファから読み込む
+//
+static int SnapshotRead(const unsigned char *buffer, int offset, void *data, int size)
+{
+    if (offset < 0 || offset + size > kSnapshotBufferSize) {
+        return -1;
+    }
+    memcpy(data, buffer + offset, size);
+    return offset + size;
+}
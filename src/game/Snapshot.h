@@ -0,0 +1,68 @@
+// Snapshot.h - スナップショット
+//
+#pragma once
+
+// 外部参照
+//
+#include <stdbool.h>
+#include "pd_api.h"
+#include "Iocs.h"
+#include "Define.h"
+
+
+// バッファ
+//
+enum {
+    kSnapshotMagic = 0x50414e53, 
+    kSnapshotBufferSize = 32 * 1024, 
+    kSnapshotRingSize = 60, 
+    kSnapshotSlotSize = kSnapshotRingSize + 1, 
+    kSnapshotSlotSave = kSnapshotRingSize, 
+};
+
+// ヘッダ
+//
+struct SnapshotHeader {
+
+    // 識別子
+    uint32_t magic;
+
+    // 全体の大きさ
+    int size;
+
+    // 乱数
+    struct IocsRandom random;
+
+    // ボタンのリピート
+    int buttonRepeatCounts[kIocsButtonSize];
+
+};
+
+// スナップショット
+//
+struct Snapshot {
+
+    // すべてのスロットのバッファ（1 つの連続した領域）
+    unsigned char *buffers;
+
+    // 書き込み済みの大きさ
+    int sizes[kSnapshotSlotSize];
+
+    // リングバッファ
+    int ringHead;
+    int ringSize;
+
+    // 大きさが足りないことを報告した
+    bool overflow;
+
+};
+
+// 外部参照関数
+//
+extern void SnapshotInitialize(void);
+extern void SnapshotRelease(void);
+extern bool SnapshotTake(void);
+extern bool SnapshotRewind(int frame);
+extern int SnapshotGetRewindSize(void);
+extern bool SnapshotSave(void);
+extern bool SnapshotLoad(void);
@@ -62,14 +62,27 @@ int eventHandler(PlaydateAPI *playdate, PDSystemEvent event, uint32_t arg)
 //
 static int updateCallback(void *userdata)
 {
-	// IOCS の更新の開始
-	IocsUpdateBegin();
+	// 経過時間から固定ステップの数を求める
+	int step = IocsUpdateFrame();
 
-	// シーンの更新の開始
-	SceneUpdateBegin();
+	// 固定ステップの更新（描画が遅れたときは複数回更新して描画を間引く）
+	for (int i = 0; i < step; i++) {
 
-	// アクタの更新
-	ActorUpdate();
+		// IOCS の更新の開始
+		IocsUpdateBegin();
+
+		// シーンの更新の開始
+		SceneUpdateBegin();
+
+		// アクタの更新
+		ActorUpdate();
+
+		// シーンの更新の完了
+		SceneUpdateEnd();
+
+		// IOCS の更新の完了
+		IocsUpdateEnd();
+	}
 
 	// 画面のクリア
 	IocsClearScreen();
@@ -77,11 +90,11 @@ static int updateCallback(void *userdata)
 	// アクタの描画
 	ActorDraw();
 
-	// シーンの更新の完了
-	SceneUpdateEnd();
+	// IOCS の描画
+	IocsDraw();
 
-	// IOCS の更新の完了
-	IocsUpdateEnd();
+	// フレームの空き時間で次のシーンを先読みする
+	SceneUpdatePrefetch(IocsGetFrameIdle());
 
 	// 終了
 	return 1;
@@ -41,7 +41,7 @@ void TitleUpdate(struct Title *title)
     if (title == NULL) {
 
         // タイトルの作成
-        title = playdate->system->realloc(NULL, sizeof (struct Title));
+        title = SceneAllocate(sizeof (struct Title));
         if (title == NULL) {
             playdate->system->error("%s: %d: title instance is not created.", __FILE__, __LINE__);
             return;
@@ -77,8 +77,10 @@ static void TitleUnload(struct Title *title)
     // アクタの解放
     ActorUnloadAll();
 
-    // スプライトの解放
-    AsepriteUnloadAllSprites();
+    // スプライトの解放（先読みしたゲームのスプライトは残す）
+    for (int i = 0; i < kTitleSpriteNameSize; i++) {
+        AsepriteUnloadSprite(titleSpriteNames[i]);
+    }
 }
 
 // 処理を遷移する
@@ -96,6 +98,9 @@ static void TitleLoad(struct Title *title)
     // 初期化
     if (title->state == 0) {
 
+        // ゲームの先読みの開始
+        ApplicationPrefetch(kApplicationSceneGame);
+
         // 初期化の完了
         ++title->state;
     }
@@ -115,8 +120,12 @@ static void TitlePlay(struct Title *title)
         ++title->state;
     }
 
-    // 処理の遷移
-    TitleTransition(title, (TitleFunction)TitleDone);
+    // 開始の待機
+    if (IocsIsButtonEdge(kButtonA)) {
+
+        // 処理の遷移
+        TitleTransition(title, (TitleFunction)TitleDone);
+    }
 }
 
 // タイトルを完了する
@@ -0,0 +1,437 @@
+// fieldbench.cpp - フィールド生成のシードスイープとベンチマーク
+//
+// src/game/Maze.c と src/game/Field.c をホスト上でリンクし、
+// 多数のシードでフィールドを生成して時間・メモリ・構造を集計する。
+// Field.c はフィールドを静的変数で持つため、並列化はコア数ぶんのプロセスで行う。
+//
+
+// 参照ファイルのインクルード
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <poll.h>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+extern "C" {
+#include "pd_api.h"
+#include "Iocs.h"
+#include "IocsRandom.h"
+#include "Actor.h"
+#include "Aseprite.h"
+#include "Game.h"
+#include "Maze.h"
+#include "Field.h"
+}
+
+
+// シードごとの結果
+//
+struct FieldBenchResult {
+    uint32_t seed;
+    double microsecond;
+    size_t peakBytes;
+    int deadend;
+    int space;
+    int reachable;
+    int ladder;
+};
+
+// メモリの計測
+//
+static size_t fieldBenchLiveBytes = 0;
+static size_t fieldBenchPeakBytes = 0;
+
+// シーンのアリーナの代替（1 回の生成ごとにまとめて解放する）
+//
+static std::vector<void *> fieldBenchArena;
+
+// Playdate API の代替（キャッシュは常に外れる）
+//
+static void *FieldBenchRealloc(void *ptr, size_t size)
+{
+    size_t *block = ptr != NULL ? (size_t *)ptr - 2 : NULL;
+    if (block != NULL) {
+        fieldBenchLiveBytes -= block[0];
+    }
+    if (size == 0) {
+        free(block);
+        return NULL;
+    }
+    block = (size_t *)realloc(block, size + 2 * sizeof (size_t));
+    if (block == NULL) {
+        return NULL;
+    }
+    block[0] = size;
+    fieldBenchLiveBytes += size;
+    if (fieldBenchPeakBytes < fieldBenchLiveBytes) {
+        fieldBenchPeakBytes = fieldBenchLiveBytes;
+    }
+    return block + 2;
+}
+static void FieldBenchError(const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    va_end(args);
+    fprintf(stderr, "\n");
+    exit(-1);
+}
+static void FieldBenchLog(const char *format, ...)
+{
+}
+static int FieldBenchFormatString(char **outstring, const char *format, ...)
+{
+    char *string = NULL;
+    va_list args;
+    va_start(args, format);
+    int length = vasprintf(&string, format, args);
+    va_end(args);
+    *outstring = NULL;
+    if (length >= 0) {
+        *outstring = (char *)FieldBenchRealloc(NULL, length + 1);
+        memcpy(*outstring, string, length + 1);
+        free(string);
+    }
+    return length;
+}
+static int FieldBenchStat(const char *path, FileStat *stat)
+{
+    return -1;
+}
+static int FieldBenchMkdir(const char *path)
+{
+    return -1;
+}
+static SDFile *FieldBenchOpen(const char *path, FileOptions mode)
+{
+    return NULL;
+}
+static struct playdate_sys fieldBenchSystem;
+static struct playdate_file fieldBenchFile;
+static PlaydateAPI fieldBenchPlaydate;
+
+// Field.c から参照される関数の代替
+//
+extern "C" {
+PlaydateAPI *IocsGetPlaydate(void)
+{
+    return &fieldBenchPlaydate;
+}
+void *IocsRealloc(IocsMemoryTag tag, void *pointer, size_t size)
+{
+    return FieldBenchRealloc(pointer, size);
+}
+void *SceneAllocate(size_t size)
+{
+    void *pointer = FieldBenchRealloc(NULL, size);
+    if (pointer != NULL) {
+        fieldBenchArena.push_back(pointer);
+    }
+    return pointer;
+}
+void IocsSetRandomSeed(struct IocsRandom *random, uint32_t seed)
+{
+    random->key = IocsMakeRandomKey(seed, NULL);
+    random->counter = 0;
+}
+int IocsGetRandomNumber(struct IocsRandom *random)
+{
+    return (int)(IocsMixRandomAt(random->key, random->counter++) & 0x7fffffff);
+}
+struct Actor *ActorLoad(ActorFunction update, int priority) { return NULL; }
+void ActorSetUnload(struct Actor *actor, ActorFunction unload) {}
+void ActorSetDraw(struct Actor *actor, ActorFunction draw, int order) {}
+void ActorSetTag(struct Actor *actor, int tag) {}
+void AsepriteStartSpriteAnimation(struct AsepriteSpriteAnimation *animation, const char *spriteName, const char *animationName, bool loop) {}
+void AsepriteUpdateSpriteAnimation(struct AsepriteSpriteAnimation *animation) {}
+void AsepriteDrawSpriteAnimation(struct AsepriteSpriteAnimation *animation, int x, int y, LCDBitmapDrawMode mode, LCDBitmapFlip flip) {}
+void IocsSetDrawClip(int x, int y, int width, int height) {}
+void IocsClearDrawClip(void) {}
+bool GameIsPlay(void) { return false; }
+struct Vector *GameGetCamera(void) { return NULL; }
+}
+
+// 1 つのシードでフィールドを生成して計測する
+//
+static void FieldBenchRun(uint32_t seed, struct FieldBenchResult *result)
+{
+    // 生成の計測
+    fieldBenchLiveBytes = 0;
+    fieldBenchPeakBytes = 0;
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    FieldInitialize(seed);
+    while (!FieldBuild(0)) {
+        ;
+    }
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    result->seed = seed;
+    result->microsecond = std::chrono::duration<double, std::micro>(end - begin).count();
+    result->peakBytes = fieldBenchPeakBytes;
+
+    // 構造の集計
+    struct Field *field = FieldGetInstance();
+    {
+        // 行き止まり
+        result->deadend = 0;
+        for (int i = 0; i < field->maze->routeSize.x * field->maze->routeSize.y; i++) {
+            unsigned char route = field->maze->routes[i];
+            if (route != 0 && (route & (route - 1)) == 0) {
+                ++result->deadend;
+            }
+        }
+
+        // 梯子のタイルと空間
+        result->ladder = 0;
+        result->space = 0;
+        for (int y = 0; y < kFieldSizeY; y++) {
+            for (int x = 0; x < kFieldSizeX; x++) {
+                if (FieldIsLadder(x * kFieldSizePixel, y * kFieldSizePixel)) {
+                    ++result->ladder;
+                }
+                if (FieldIsSpace(x * kFieldSizePixel, y * kFieldSizePixel)) {
+                    ++result->space;
+                }
+            }
+        }
+
+        // 開始位置から到達できる空間
+        static unsigned char visits[kFieldSizeY][kFieldSizeX];
+        static int queues[kFieldSizeX * kFieldSizeY];
+        memset(visits, 0, sizeof (visits));
+        struct Vector start;
+        FieldGetStartPosition(&start);
+        int head = 0;
+        int tail = 0;
+        {
+            int x = start.x / kFieldSizePixel;
+            int y = start.y / kFieldSizePixel;
+            visits[y][x] = 1;
+            queues[tail++] = y * kFieldSizeX + x;
+        }
+        while (head < tail) {
+            int x = queues[head] % kFieldSizeX;
+            int y = queues[head] / kFieldSizeX;
+            ++head;
+            int xs[4] = {x > 0 ? x - 1 : kFieldSizeX - 1, x < kFieldSizeX - 1 ? x + 1 : 0, x, x, };
+            int ys[4] = {y, y, y - 1, y + 1, };
+            for (int i = 0; i < 4; i++) {
+                if (
+                    ys[i] >= 0 && ys[i] < kFieldSizeY &&
+                    visits[ys[i]][xs[i]] == 0 &&
+                    FieldIsSpace(xs[i] * kFieldSizePixel, ys[i] * kFieldSizePixel)
+                ) {
+                    visits[ys[i]][xs[i]] = 1;
+                    queues[tail++] = ys[i] * kFieldSizeX + xs[i];
+                }
+            }
+        }
+        result->reachable = tail;
+    }
+
+    // フィールドの解放
+    FieldRelease();
+    for (size_t i = 0; i < fieldBenchArena.size(); i++) {
+        FieldBenchRealloc(fieldBenchArena[i], 0);
+    }
+    fieldBenchArena.clear();
+}
+
+// パーセンタイルを取得する
+//
+static double FieldBenchPercentile(std::vector<double> &values, double percent)
+{
+    size_t index = (size_t)(percent / 100.0 * (values.size() - 1) + 0.5);
+    return values[index];
+}
+
+// メインプログラムのエントリ
+//
+int main(int argc, const char *argv[])
+{
+    // 引数の初期化
+    uint32_t seed = kFieldRandomSeed;
+    int count = 1000;
+    int jobs = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    double minimum = 99.0;
+    bool verbose = false;
+
+    // 引数の取得
+    while (--argc > 0) {
+        ++argv;
+        if (strcasecmp(*argv, "-s") == 0 && argc > 1) {
+            seed = (uint32_t)strtoul(*++argv, NULL, 0);
+            --argc;
+        } else if (strcasecmp(*argv, "-n") == 0 && argc > 1) {
+            count = atoi(*++argv);
+            --argc;
+        } else if (strcasecmp(*argv, "-j") == 0 && argc > 1) {
+            jobs = atoi(*++argv);
+            --argc;
+        } else if (strcasecmp(*argv, "-r") == 0 && argc > 1) {
+            minimum = atof(*++argv);
+            --argc;
+        } else if (strcasecmp(*argv, "-v") == 0) {
+            verbose = true;
+        } else {
+            fprintf(stderr, "usage: fieldbench [-s seed] [-n count] [-j jobs] [-r reachable%%] [-v]\n");
+            return -1;
+        }
+    }
+    if (count <= 0) {
+        return -1;
+    }
+    if (jobs <= 0) {
+        jobs = 1;
+    }
+    if (jobs > count) {
+        jobs = count;
+    }
+
+    // Playdate API の設定
+    fieldBenchSystem.realloc = FieldBenchRealloc;
+    fieldBenchSystem.error = FieldBenchError;
+    fieldBenchSystem.logToConsole = FieldBenchLog;
+    fieldBenchSystem.formatString = FieldBenchFormatString;
+    fieldBenchFile.stat = FieldBenchStat;
+    fieldBenchFile.mkdir = FieldBenchMkdir;
+    fieldBenchFile.open = FieldBenchOpen;
+    fieldBenchPlaydate.system = &fieldBenchSystem;
+    fieldBenchPlaydate.file = &fieldBenchFile;
+
+    // 処理の開始
+    fprintf(stdout, "fieldbench ...\n");
+    fprintf(stdout, "seed = %u, count = %d, jobs = %d\n", seed, count, jobs);
+
+    // ワーカの起動
+    std::vector<struct FieldBenchResult> results(count);
+    std::vector<pid_t> pids(jobs);
+    std::vector<int> pipes(jobs);
+    for (int job = 0; job < jobs; job++) {
+        int fds[2];
+        if (pipe(fds) != 0) {
+            fprintf(stderr, "error: pipe is not created.\n");
+            return -1;
+        }
+        pid_t pid = fork();
+        if (pid < 0) {
+            fprintf(stderr, "error: worker is not forked.\n");
+            return -1;
+        }
+        if (pid == 0) {
+            close(fds[0]);
+            for (int i = job; i < count; i += jobs) {
+                struct FieldBenchResult result;
+                FieldBenchRun(seed + (uint32_t)i, &result);
+                if (write(fds[1], &result, sizeof (result)) != sizeof (result)) {
+                    _exit(-1);
+                }
+            }
+            close(fds[1]);
+            _exit(0);
+        }
+        close(fds[1]);
+        pids[job] = pid;
+        pipes[job] = fds[0];
+    }
+
+    // 結果の回収（パイプが詰まってワーカが止まらないように、読めるものからすべて読む）
+    {
+        std::vector<int> receives(jobs, 0);
+        std::vector<size_t> offsets(jobs, 0);
+        std::vector<struct pollfd> polls(jobs);
+        int running = jobs;
+        for (int job = 0; job < jobs; job++) {
+            polls[job].fd = pipes[job];
+            polls[job].events = POLLIN;
+        }
+        while (running > 0) {
+            if (poll(polls.data(), jobs, -1) < 0) {
+                fprintf(stderr, "error: workers are not polled.\n");
+                return -1;
+            }
+            for (int job = 0; job < jobs; job++) {
+                if (polls[job].fd < 0 || (polls[job].revents & (POLLIN | POLLHUP | POLLERR)) == 0) {
+                    continue;
+                }
+                int i = job + receives[job] * jobs;
+                ssize_t size = i < count ? read(pipes[job], (char *)&results[i] + offsets[job], sizeof (struct FieldBenchResult) - offsets[job]) : 0;
+                if (size > 0) {
+                    offsets[job] += size;
+                    if (offsets[job] == sizeof (struct FieldBenchResult)) {
+                        offsets[job] = 0;
+                        ++receives[job];
+                    }
+                } else {
+                    if (i < count) {
+                        fprintf(stderr, "error: worker %d is failed.\n", job);
+                        return -1;
+                    }
+                    close(pipes[job]);
+                    polls[job].fd = -1;
+                    --running;
+                }
+            }
+        }
+        for (int job = 0; job < jobs; job++) {
+            waitpid(pids[job], NULL, 0);
+        }
+    }
+
+    // 集計
+    std::vector<double> times;
+    size_t peak = 0;
+    long deadend = 0;
+    long ladder = 0;
+    int degenerate = 0;
+    for (int i = 0; i < count; i++) {
+        struct FieldBenchResult *result = &results[i];
+        double ratio = result->space > 0 ? 100.0 * result->reachable / result->space : 0.0;
+        bool flag = ratio < minimum;
+        times.push_back(result->microsecond);
+        peak = std::max(peak, result->peakBytes);
+        deadend += result->deadend;
+        ladder += result->ladder;
+        if (flag) {
+            ++degenerate;
+        }
+        if (verbose || flag) {
+            fprintf(
+                stdout,
+                "%s%u: %.1f us, %zu bytes, deadend = %d, reachable = %d/%d (%.1f%%), ladder tiles = %d\n",
+                flag ? "degenerate: " : "",
+                result->seed,
+                result->microsecond,
+                result->peakBytes,
+                result->deadend,
+                result->reachable,
+                result->space,
+                ratio,
+                result->ladder
+            );
+        }
+    }
+    std::sort(times.begin(), times.end());
+
+    // 結果の表示
+    fprintf(stdout, "time p50 = %.1f us, p90 = %.1f us, p99 = %.1f us, max = %.1f us\n",
+        FieldBenchPercentile(times, 50.0),
+        FieldBenchPercentile(times, 90.0),
+        FieldBenchPercentile(times, 99.0),
+        times.back()
+    );
+    fprintf(stdout, "memory peak = %zu bytes\n", peak);
+    fprintf(stdout, "deadend avg = %.2f, ladder tiles avg = %.2f\n", (double)deadend / count, (double)ladder / count);
+    fprintf(stdout, "degenerate = %d (reachable < %.1f%%)\n", degenerate, minimum);
+    fprintf(stdout, "done.\n");
+
+    // 終了
+    return degenerate > 0 ? 1 : 0;
+}